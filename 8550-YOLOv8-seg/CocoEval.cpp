@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include "CocoEval.h"
+
+// Column-major run lengths, either the plain list or the compressed string
+// form written by pycocotools (LEB128-like, 5 bits per character).
+static std::vector<uint32_t> decodeRLE(const cv::FileNode& counts) {
+    std::vector<uint32_t> runs;
+    if (counts.isSeq()) {
+        for (const auto& node : counts) {
+            runs.push_back((int)node);
+        }
+        return runs;
+    }
+
+    std::string s = counts.string();
+    std::vector<long long> cnts;
+    size_t p = 0;
+    while (p < s.size()) {
+        long long x = 0;
+        int k = 0;
+        bool more = true;
+        while (more && p < s.size()) {
+            long long c = s[p] - 48;
+            x |= (c & 0x1f) << (5 * k);
+            more = c & 0x20;
+            p++;
+            k++;
+            if (!more && (c & 0x10)) {
+                x |= -1LL << (5 * k);
+            }
+        }
+        if (cnts.size() > 2) {
+            x += cnts[cnts.size() - 2];
+        }
+        cnts.push_back(x);
+    }
+    for (long long c : cnts) {
+        runs.push_back((uint32_t)std::max(c, 0LL));
+    }
+    return runs;
+}
+
+static std::string baseName(const std::string& path) {
+    size_t pos = path.find_last_of('/');
+    return pos == std::string::npos ? path : path.substr(pos + 1);
+}
+
+bool CocoEvaluator::Load(const std::string& annotation_path) {
+    cv::FileStorage fs(annotation_path, cv::FileStorage::READ);
+    if (!fs.isOpened()) {
+        printf("ERROR: Can't open annotations %s\n", annotation_path.c_str());
+        return false;
+    }
+
+    std::vector<int> categoryIds;
+    for (const auto& node : fs["categories"]) {
+        categoryIds.push_back((int)node["id"]);
+    }
+    std::sort(categoryIds.begin(), categoryIds.end());
+    std::map<int, int> labels;
+    for (size_t i = 0; i < categoryIds.size(); i++) {
+        labels[categoryIds[i]] = i;
+    }
+    m_categories = categoryIds.size();
+
+    std::map<int, std::string> names;
+    for (const auto& node : fs["images"]) {
+        std::string name = baseName(node["file_name"].string());
+        names[(int)node["id"]] = name;
+        ImageInfo& image = m_images[name];
+        image.width = (int)node["width"];
+        image.height = (int)node["height"];
+    }
+
+    size_t count = 0;
+    for (const auto& node : fs["annotations"]) {
+        auto name = names.find((int)node["image_id"]);
+        auto label = labels.find((int)node["category_id"]);
+        if (name == names.end() || label == labels.end()) {
+            continue;
+        }
+
+        GroundTruth gt;
+        gt.label = label->second;
+        gt.crowd = !node["iscrowd"].empty() && (int)node["iscrowd"] != 0;
+        cv::FileNode bbox = node["bbox"];
+        if (bbox.size() == 4) {
+            gt.bbox = cv::Rect2f((float)bbox[0], (float)bbox[1], (float)bbox[2], (float)bbox[3]);
+        }
+
+        cv::FileNode segmentation = node["segmentation"];
+        if (segmentation.isSeq()) {
+            for (const auto& polygon : segmentation) {
+                std::vector<cv::Point> points;
+                for (size_t i = 0; i + 1 < polygon.size(); i += 2) {
+                    points.push_back(cv::Point(cvRound((float)polygon[i]), cvRound((float)polygon[i + 1])));
+                }
+                gt.polygons.push_back(points);
+            }
+        } else if (segmentation.isMap()) {
+            gt.rle = decodeRLE(segmentation["counts"]);
+        }
+
+        m_images[name->second].objects.push_back(gt);
+        count++;
+    }
+
+    m_evals.assign(m_categories, CategoryEval());
+    printf("INFO : Loaded %zu images, %zu annotations, %zu categories\n", m_images.size(), count, m_categories);
+    return true;
+}
+
+bool CocoEvaluator::HasImage(const std::string& file_name) const {
+    return m_images.find(baseName(file_name)) != m_images.end();
+}
+
+int CocoEvaluator::GroundTruthArea(const std::string& file_name, size_t index) const {
+    auto it = m_images.find(baseName(file_name));
+    if (it == m_images.end() || index >= it->second.objects.size()) {
+        return -1;
+    }
+    const ImageInfo& image = it->second;
+    return cv::countNonZero(Rasterize(image.objects[index], image.width, image.height));
+}
+
+cv::Mat CocoEvaluator::Rasterize(const GroundTruth& gt, int width, int height) const {
+    cv::Mat mask = cv::Mat::zeros(height, width, CV_8U);
+    if (!gt.polygons.empty()) {
+        cv::fillPoly(mask, gt.polygons, cv::Scalar(1));
+    } else if (!gt.rle.empty()) {
+        size_t index = 0;
+        size_t total = (size_t)width * height;
+        for (size_t r = 0; r < gt.rle.size(); r++) {
+            size_t end = std::min(index + gt.rle[r], total);
+            if (r % 2 == 1) {
+                for (size_t i = index; i < end; i++) {
+                    mask.at<uint8_t>(i % height, i / height) = 1;
+                }
+            }
+            index = end;
+        }
+    }
+    return mask;
+}
+
+void CocoEvaluator::MatchImage(const std::vector<float>& scores,
+                               const std::vector<std::vector<double> >& ious,
+                               const std::vector<bool>& crowd,
+                               std::vector<Match>& out) {
+    size_t base = out.size();
+    for (float score : scores) {
+        out.push_back(Match{score, 0, 0});
+    }
+
+    // ground truth comes sorted with the crowd regions last
+    for (int t = 0; t < kThresholds; t++) {
+        double threshold = 0.5 + 0.05 * t;
+        std::vector<bool> taken(crowd.size(), false);
+        for (size_t d = 0; d < scores.size(); d++) {
+            double best = std::min(threshold, 1 - 1e-10);
+            int m = -1;
+            for (size_t g = 0; g < crowd.size(); g++) {
+                if (taken[g] && !crowd[g]) {
+                    continue;
+                }
+                if (m > -1 && !crowd[m] && crowd[g]) {
+                    break;
+                }
+                if (ious[d][g] < best) {
+                    continue;
+                }
+                best = ious[d][g];
+                m = g;
+            }
+            if (m == -1) {
+                continue;
+            }
+            taken[m] = true;
+            if (crowd[m]) {
+                out[base + d].ignored |= 1 << t;
+            } else {
+                out[base + d].matched |= 1 << t;
+            }
+        }
+    }
+}
+
+void CocoEvaluator::AddResults(const std::string& file_name, const std::vector<ObjectData>& results) {
+    auto it = m_images.find(baseName(file_name));
+    if (it == m_images.end()) {
+        return;
+    }
+    const ImageInfo& image = it->second;
+
+    std::map<int, CategoryEval> evals;
+    std::vector<cv::Mat> gtMasks(image.objects.size());
+
+    for (size_t c = 0; c < m_categories; c++) {
+        std::vector<size_t> gts;
+        for (size_t g = 0; g < image.objects.size(); g++) {
+            if (image.objects[g].label == (int)c && !image.objects[g].crowd) gts.push_back(g);
+        }
+        for (size_t g = 0; g < image.objects.size(); g++) {
+            if (image.objects[g].label == (int)c && image.objects[g].crowd) gts.push_back(g);
+        }
+        std::vector<const ObjectData*> dets;
+        for (const auto& result : results) {
+            if (result.label == (int)c) dets.push_back(&result);
+        }
+        if (gts.empty() && dets.empty()) {
+            continue;
+        }
+        std::stable_sort(dets.begin(), dets.end(), [] (const ObjectData* left, const ObjectData* right) {
+            return left->confidence > right->confidence;
+        });
+        if (dets.size() > kMaxDets) {
+            dets.resize(kMaxDets);
+        }
+
+        CategoryEval& eval = evals[c];
+        std::vector<bool> crowd;
+        for (size_t g : gts) {
+            crowd.push_back(image.objects[g].crowd);
+            if (!image.objects[g].crowd) eval.positives++;
+        }
+
+        std::vector<float> scores;
+        std::vector<std::vector<double> > boxIous(dets.size(), std::vector<double>(gts.size(), 0.0));
+        std::vector<std::vector<double> > maskIous(dets.size(), std::vector<double>(gts.size(), 0.0));
+        for (size_t d = 0; d < dets.size(); d++) {
+            scores.push_back(dets[d]->confidence);
+
+            cv::Rect2f box(dets[d]->bbox.x, dets[d]->bbox.y, dets[d]->bbox.width, dets[d]->bbox.height);
+            cv::Mat detMask;
+            if (!dets[d]->mask.empty()) {
+                if (dets[d]->mask.cols != image.width || dets[d]->mask.rows != image.height) {
+                    cv::resize(dets[d]->mask, detMask, cv::Size(image.width, image.height), 0, 0, cv::INTER_NEAREST);
+                    detMask = detMask != 0;
+                } else {
+                    detMask = dets[d]->mask != 0;
+                }
+            } else {
+                detMask = cv::Mat::zeros(image.height, image.width, CV_8U);
+            }
+            double detArea = cv::countNonZero(detMask);
+
+            for (size_t j = 0; j < gts.size(); j++) {
+                const GroundTruth& gt = image.objects[gts[j]];
+
+                double inter = (box & gt.bbox).area();
+                double unio = gt.crowd ? box.area() : box.area() + gt.bbox.area() - inter;
+                boxIous[d][j] = unio > 0 ? inter / unio : 0.0;
+
+                cv::Mat& gtMask = gtMasks[gts[j]];
+                if (gtMask.empty()) {
+                    gtMask = Rasterize(gt, image.width, image.height) != 0;
+                }
+                cv::Mat both;
+                cv::bitwise_and(detMask, gtMask, both);
+                inter = cv::countNonZero(both);
+                unio = gt.crowd ? detArea : detArea + cv::countNonZero(gtMask) - inter;
+                maskIous[d][j] = unio > 0 ? inter / unio : 0.0;
+            }
+        }
+
+        MatchImage(scores, boxIous, crowd, eval.box);
+        MatchImage(scores, maskIous, crowd, eval.mask);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [c, eval] : evals) {
+        m_evals[c].positives += eval.positives;
+        m_evals[c].box.insert(m_evals[c].box.end(), eval.box.begin(), eval.box.end());
+        m_evals[c].mask.insert(m_evals[c].mask.end(), eval.mask.begin(), eval.mask.end());
+    }
+    m_evaluatedImages++;
+}
+
+double CocoEvaluator::Accumulate(const std::vector<Match>& matches, size_t positives, int threshold) {
+    std::vector<Match> sorted = matches;
+    std::stable_sort(sorted.begin(), sorted.end(), [] (const Match& left, const Match& right) {
+        return left.score > right.score;
+    });
+
+    std::vector<double> recall;
+    std::vector<double> precision;
+    double tp = 0.0;
+    double fp = 0.0;
+    for (const auto& match : sorted) {
+        if (match.ignored & (1 << threshold)) {
+            continue;
+        }
+        if (match.matched & (1 << threshold)) {
+            tp += 1.0;
+        } else {
+            fp += 1.0;
+        }
+        recall.push_back(tp / positives);
+        precision.push_back(tp / (tp + fp));
+    }
+    for (size_t i = precision.size(); i > 1; i--) {
+        precision[i - 2] = std::max(precision[i - 2], precision[i - 1]);
+    }
+
+    double sum = 0.0;
+    for (int r = 0; r <= 100; r++) {
+        size_t i = std::lower_bound(recall.begin(), recall.end(), r / 100.0) - recall.begin();
+        if (i < precision.size()) {
+            sum += precision[i];
+        }
+    }
+    return sum / 101.0;
+}
+
+CocoEvaluator::Summary CocoEvaluator::Summarize() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Summary summary;
+    summary.images = m_evaluatedImages;
+
+    size_t categories = 0;
+    for (const auto& eval : m_evals) {
+        if (eval.positives == 0) {
+            continue;
+        }
+        categories++;
+        for (int t = 0; t < kThresholds; t++) {
+            double box = Accumulate(eval.box, eval.positives, t);
+            double mask = Accumulate(eval.mask, eval.positives, t);
+            summary.boxAP += box;
+            summary.maskAP += mask;
+            if (t == 0) {
+                summary.boxAP50 += box;
+                summary.maskAP50 += mask;
+            }
+        }
+    }
+    if (categories > 0) {
+        summary.boxAP /= categories * kThresholds;
+        summary.maskAP /= categories * kThresholds;
+        summary.boxAP50 /= categories;
+        summary.maskAP50 /= categories;
+    }
+    return summary;
+}
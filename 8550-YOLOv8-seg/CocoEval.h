@@ -0,0 +1,85 @@
+#ifndef __COCO_EVAL_H__
+#define __COCO_EVAL_H__
+
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+
+#include <opencv2/opencv.hpp>
+
+#include "YOLOv8s.h"
+
+// Box and mask mAP against COCO-format ground truth, computed the way
+// pycocotools does for area range "all" and maxDets 100: IoU thresholds
+// 0.50:0.05:0.95, crowd regions ignored, 101-point interpolated precision.
+// Detections are matched per image as they arrive, so full-resolution
+// masks never need to be kept around. ObjectData::label indexes the
+// annotation categories sorted by id.
+class CocoEvaluator {
+public:
+    struct Summary {
+        size_t images = 0;
+        double boxAP = 0.0;
+        double boxAP50 = 0.0;
+        double maskAP = 0.0;
+        double maskAP50 = 0.0;
+    };
+
+    bool Load(const std::string& annotation_path);
+    bool HasImage(const std::string& file_name) const;
+    // pixels of the image's index-th annotation, in file order, as
+    // rasterized for mask IoU; -1 if there is no such annotation
+    int GroundTruthArea(const std::string& file_name, size_t index) const;
+
+    // thread-safe
+    void AddResults(const std::string& file_name, const std::vector<ObjectData>& results);
+    Summary Summarize() const;
+
+private:
+    static const int kThresholds = 10;
+    static const size_t kMaxDets = 100;
+
+    struct GroundTruth {
+        int label = -1;
+        bool crowd = false;
+        cv::Rect2f bbox;
+        std::vector<std::vector<cv::Point> > polygons;
+        std::vector<uint32_t> rle;
+    };
+
+    struct ImageInfo {
+        int width = 0;
+        int height = 0;
+        std::vector<GroundTruth> objects;
+    };
+
+    // one detection after matching: bit t of matched/ignored is threshold t
+    struct Match {
+        float score;
+        uint16_t matched;
+        uint16_t ignored;
+    };
+
+    struct CategoryEval {
+        size_t positives = 0;
+        std::vector<Match> box;
+        std::vector<Match> mask;
+    };
+
+    cv::Mat Rasterize(const GroundTruth& gt, int width, int height) const;
+    static void MatchImage(const std::vector<float>& scores,
+                           const std::vector<std::vector<double> >& ious,
+                           const std::vector<bool>& crowd,
+                           std::vector<Match>& out);
+    static double Accumulate(const std::vector<Match>& matches, size_t positives, int threshold);
+
+    std::map<std::string, ImageInfo> m_images;
+    size_t m_categories = 0;
+
+    mutable std::mutex m_mutex;
+    std::vector<CategoryEval> m_evals;
+    size_t m_evaluatedImages = 0;
+};
+
+#endif // __COCO_EVAL_H__
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <ctype.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include "CpuTopology.h"
+
+static const char* kClassNames[] = { "efficiency", "performance", "prime" };
+
+// cpus taken by isolated placements, with the number of owners of each
+static std::mutex g_reservedMutex;
+static std::map<int, int> g_reserved;
+
+static bool readInt(const std::string& path, int& value) {
+    std::ifstream in(path);
+    return static_cast<bool>(in >> value);
+}
+
+// "0-3,5,7-8" -> {0,1,2,3,5,7,8}
+static bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        char* end = nullptr;
+        long first = strtol(item.c_str(), &end, 10);
+        if (end == item.c_str()) return false;
+        long last = first;
+        if (*end == '-') {
+            const char* next = end + 1;
+            last = strtol(next, &end, 10);
+            if (end == next) return false;
+        }
+        if (*end != '\0' && *end != '\n') return false;
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back((int)cpu);
+        }
+    }
+    return !cpus.empty();
+}
+
+const CpuTopology& CpuTopology::System() {
+    static CpuTopology topology;
+    static std::once_flag once;
+    std::call_once(once, [] { topology.Load(); });
+    return topology;
+}
+
+bool CpuTopology::Load(const std::string& root) {
+    m_cpus.clear();
+
+    std::vector<int> online;
+    std::ifstream in(root + "/online");
+    std::string text;
+    if (!(in && std::getline(in, text) && parseCpuList(text, online))) {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < std::max(count, 1L); i++) online.push_back(i);
+    }
+
+    bool haveCapacity = true;
+    for (int id : online) {
+        CpuInfo cpu;
+        cpu.id = id;
+        std::string dir = root + "/cpu" + std::to_string(id);
+        if (!readInt(dir + "/cpu_capacity", cpu.capacity)) {
+            haveCapacity = false;
+        }
+        m_cpus.push_back(cpu);
+    }
+    if (!haveCapacity) {
+        for (auto& cpu : m_cpus) {
+            std::string dir = root + "/cpu" + std::to_string(cpu.id);
+            if (!readInt(dir + "/cpufreq/cpuinfo_max_freq", cpu.capacity)) {
+                cpu.capacity = 0;
+            }
+        }
+    }
+
+    std::set<int> levels;
+    for (auto& cpu : m_cpus) levels.insert(cpu.capacity);
+    int lowest = *levels.begin();
+    int highest = *levels.rbegin();
+    for (auto& cpu : m_cpus) {
+        if (levels.size() == 1) {
+            cpu.coreClass = CORE_PERFORMANCE;
+        } else if (cpu.capacity == lowest) {
+            cpu.coreClass = CORE_EFFICIENCY;
+        } else if (cpu.capacity == highest && levels.size() >= 3) {
+            cpu.coreClass = CORE_PRIME;
+        } else {
+            cpu.coreClass = CORE_PERFORMANCE;
+        }
+    }
+    return true;
+}
+
+int CpuTopology::MaxCpuId() const {
+    int id = -1;
+    for (auto& cpu : m_cpus) id = std::max(id, cpu.id);
+    return id;
+}
+
+const CpuInfo* CpuTopology::Find(int id) const {
+    for (auto& cpu : m_cpus) {
+        if (cpu.id == id) return &cpu;
+    }
+    return nullptr;
+}
+
+std::vector<int> CpuTopology::CpusOf(int classes) const {
+    std::vector<int> cpus;
+    for (auto& cpu : m_cpus) {
+        if (classes & CORE_CLASS_BIT(cpu.coreClass)) cpus.push_back(cpu.id);
+    }
+    return cpus;
+}
+
+std::string CpuTopology::Describe() const {
+    std::string text;
+    for (int c = CORE_PRIME; c >= CORE_EFFICIENCY; c--) {
+        std::vector<int> cpus = CpusOf(CORE_CLASS_BIT(c));
+        if (cpus.empty()) continue;
+        if (!text.empty()) text += ", ";
+        text += std::string(kClassNames[c]) + " {";
+        for (size_t i = 0; i < cpus.size(); i++) {
+            text += (i ? "," : "") + std::to_string(cpus[i]);
+        }
+        text += "}";
+    }
+    return text;
+}
+
+const char* CpuTopology::ClassName(core_class_t coreClass) {
+    if (coreClass < CORE_EFFICIENCY || coreClass > CORE_PRIME) return "unknown";
+    return kClassNames[coreClass];
+}
+
+bool CpuTopology::ParsePlacement(const std::string& text, ThreadPlacement& placement) {
+    if (!text.empty() && isdigit((unsigned char)text[0])) {
+        placement.cpus.clear();
+        if (!parseCpuList(text, placement.cpus)) return false;
+        placement.enabled = true;
+        return true;
+    }
+
+    int classes = 0;
+    std::stringstream ss(text);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        bool found = false;
+        for (int c = CORE_EFFICIENCY; c <= CORE_PRIME; c++) {
+            if (name == kClassNames[c]) {
+                classes |= CORE_CLASS_BIT(c);
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    if (classes == 0) return false;
+    placement.classes = classes;
+    placement.cpus.clear();
+    placement.enabled = true;
+    return true;
+}
+
+bool CpuTopology::ParseSchedPolicy(const std::string& text, ThreadPlacement& placement) {
+    std::string name = text.substr(0, text.find(':'));
+    int priority = text.find(':') == std::string::npos ? 1 : atoi(text.c_str() + text.find(':') + 1);
+    if (name == "other") {
+        placement.policy = SCHED_OTHER;
+        placement.priority = 0;
+    } else if (name == "fifo") {
+        placement.policy = SCHED_FIFO;
+        placement.priority = priority;
+    } else if (name == "rr") {
+        placement.policy = SCHED_RR;
+        placement.priority = priority;
+    } else {
+        return false;
+    }
+    placement.enabled = true;
+    return true;
+}
+
+std::vector<int> PlacementCpus(const ThreadPlacement& placement, const CpuTopology& topology) {
+    std::vector<int> cpus = placement.cpus.empty() ? topology.CpusOf(placement.classes) : placement.cpus;
+    if (cpus.empty()) {
+        // e.g. "prime" on a host without a prime core
+        printf("WARN : No cpu matches the placement, using all of them\n");
+        cpus = topology.CpusOf(CORE_CLASS_ALL);
+    }
+    return cpus;
+}
+
+std::vector<int> ReserveCpus(const ThreadPlacement& placement, const CpuTopology& topology) {
+    if (!placement.enabled || !placement.isolate) {
+        return {};
+    }
+    std::vector<int> cpus = PlacementCpus(placement, topology);
+    std::lock_guard<std::mutex> lock(g_reservedMutex);
+    for (int cpu : cpus) g_reserved[cpu]++;
+    return cpus;
+}
+
+void ReleaseCpus(const std::vector<int>& cpus) {
+    std::lock_guard<std::mutex> lock(g_reservedMutex);
+    for (int cpu : cpus) {
+        auto it = g_reserved.find(cpu);
+        if (it != g_reserved.end() && --it->second <= 0) g_reserved.erase(it);
+    }
+}
+
+bool ApplyPlacement(const ThreadPlacement& placement, const CpuTopology& topology) {
+    std::vector<int> cpus = placement.enabled ? PlacementCpus(placement, topology) : topology.CpusOf(CORE_CLASS_ALL);
+    if (!placement.enabled || !placement.isolate) {
+        std::lock_guard<std::mutex> lock(g_reservedMutex);
+        std::vector<int> free;
+        for (int cpu : cpus) {
+            if (g_reserved.count(cpu) == 0) free.push_back(cpu);
+        }
+        if (free.size() == cpus.size() || free.empty()) {
+            // nothing reserved here, or nothing else left: an unplaced
+            // thread is left alone, a placed one keeps its cpus
+            if (!placement.enabled) return true;
+        } else {
+            cpus = free;
+        }
+    }
+
+    bool ok = true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        printf("ERROR: pthread_setaffinity_np failed: %s\n", strerror(err));
+        ok = false;
+    }
+
+    if (placement.enabled && (placement.policy != SCHED_OTHER || placement.priority != 0)) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = placement.policy == SCHED_OTHER ? 0 : placement.priority;
+        err = pthread_setschedparam(pthread_self(), placement.policy, &param);
+        if (err != 0) {
+            printf("WARN : pthread_setschedparam failed: %s\n", strerror(err));
+        }
+    }
+    return ok;
+}
+
+int CurrentCpu() {
+    return sched_getcpu();
+}
+
+PlacementCounter::PlacementCounter()
+    : m_size(std::max(CpuTopology::System().MaxCpuId() + 1, 1)),
+      m_counts(new std::atomic<uint64_t>[m_size]) {
+    for (size_t i = 0; i < m_size; i++) m_counts[i] = 0;
+}
+
+void PlacementCounter::Record(int cpu) {
+    if (cpu >= 0 && (size_t)cpu < m_size) {
+        m_counts[cpu].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::vector<uint64_t> PlacementCounter::Counts() const {
+    std::vector<uint64_t> counts(m_size);
+    for (size_t i = 0; i < m_size; i++) counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    return counts;
+}
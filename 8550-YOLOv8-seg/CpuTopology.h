@@ -0,0 +1,101 @@
+#ifndef __CPU_TOPOLOGY_H__
+#define __CPU_TOPOLOGY_H__
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <memory>
+
+typedef enum core_class {
+    CORE_EFFICIENCY = 0,
+    CORE_PERFORMANCE,
+    CORE_PRIME
+}core_class_t;
+
+#define CORE_CLASS_BIT(c) (1 << (c))
+#define CORE_CLASS_ALL (CORE_CLASS_BIT(CORE_EFFICIENCY) | CORE_CLASS_BIT(CORE_PERFORMANCE) | CORE_CLASS_BIT(CORE_PRIME))
+
+// Where and how a thread should run. Explicit cpus take precedence over
+// the core classes. A disabled placement only keeps the thread off
+// reserved cpus (see ReserveCpus()).
+typedef struct _ThreadPlacement {
+    bool enabled = false;
+    int classes = CORE_CLASS_ALL;   // CORE_CLASS_BIT() mask
+    std::vector<int> cpus;
+    int policy = 0;                 // SCHED_OTHER, SCHED_FIFO or SCHED_RR
+    int priority = 0;               // for SCHED_FIFO / SCHED_RR
+    // keep other threads off these cpus (e.g. the inference-submit thread).
+    // Takes effect once the owner calls ReserveCpus(), and only for threads
+    // that call ApplyPlacement() afterwards: threads placed earlier or never
+    // placed at all, such as an application's own Detect() callers, can
+    // still run there.
+    bool isolate = false;
+} ThreadPlacement;
+
+struct CpuInfo {
+    int id = -1;
+    int capacity = 0;
+    core_class_t coreClass = CORE_PERFORMANCE;
+};
+
+// Online cpus and their core class. Classes come from cpu_capacity, or
+// cpufreq/cpuinfo_max_freq where that is missing: the lowest value is
+// efficiency, the highest prime (only with three or more distinct values)
+// and the rest performance. A homogeneous host is all performance.
+class CpuTopology {
+public:
+    static const CpuTopology& System();
+
+    bool Load(const std::string& root = "/sys/devices/system/cpu");
+
+    const std::vector<CpuInfo>& Cpus() const {
+        return m_cpus;
+    }
+    int MaxCpuId() const;
+    const CpuInfo* Find(int cpu) const;
+    std::vector<int> CpusOf(int classes) const;
+    std::string Describe() const;
+
+    static const char* ClassName(core_class_t coreClass);
+    // "prime,performance", "efficiency" or a cpu list such as "0,2-3"
+    static bool ParsePlacement(const std::string& text, ThreadPlacement& placement);
+    // "other", "fifo:<prio>" or "rr:<prio>"
+    static bool ParseSchedPolicy(const std::string& text, ThreadPlacement& placement);
+
+private:
+    std::vector<CpuInfo> m_cpus;
+};
+
+// The cpus a placement resolves to on this topology.
+std::vector<int> PlacementCpus(const ThreadPlacement& placement, const CpuTopology& topology = CpuTopology::System());
+
+// Reserves the cpus of an isolated placement for its owner and returns
+// them for ReleaseCpus(). Reservations are counted, so two owners can
+// share a cpu. Reserve before the other threads are placed.
+std::vector<int> ReserveCpus(const ThreadPlacement& placement, const CpuTopology& topology = CpuTopology::System());
+void ReleaseCpus(const std::vector<int>& cpus);
+
+// Applies placement to the calling thread. A non-isolated placement, or a
+// disabled one, is kept off the reserved cpus unless nothing else is left.
+// Affinity failures make it return false; a scheduling policy that needs
+// privileges the process lacks is only reported, the affinity still
+// applies.
+bool ApplyPlacement(const ThreadPlacement& placement, const CpuTopology& topology = CpuTopology::System());
+
+// Returns the cpu the calling thread is running on, -1 if unknown.
+int CurrentCpu();
+
+// Lock-free per-cpu sample counts.
+class PlacementCounter {
+public:
+    PlacementCounter();
+
+    void Record(int cpu);
+    std::vector<uint64_t> Counts() const;
+
+private:
+    size_t m_size;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_counts;
+};
+
+#endif // __CPU_TOPOLOGY_H__
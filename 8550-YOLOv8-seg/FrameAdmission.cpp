@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "FrameAdmission.h"
+
+FrameAdmission::FrameAdmission(ObjectDetection& detector, const FrameAdmissionConfig& config, ResultFn onResult)
+    : m_detector(detector), m_config(config), m_onResult(onResult) {
+    if (m_config.policy == LATEST_WINS || m_config.queue_size < 1) m_config.queue_size = 1;
+    if (m_config.skip_n < 1) m_config.skip_n = 1;
+    if (m_config.workers < 1) m_config.workers = 1;
+    if (m_config.age_samples < 1) m_config.age_samples = 1;
+}
+
+FrameAdmission::~FrameAdmission() {
+    Stop();
+}
+
+void FrameAdmission::SetBoxesCallback(ResultFn onBoxes) {
+    m_onBoxes = onBoxes;
+}
+
+bool FrameAdmission::Start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) {
+        return true;
+    }
+    if (!m_detector.IsInitialized()) {
+        printf("ERROR: FrameAdmission needs an initialized ObjectDetection\n");
+        return false;
+    }
+    m_running = true;
+    for (int i = 0; i < m_config.workers; i++) {
+        m_workers.emplace_back(&FrameAdmission::Worker, this);
+    }
+    return true;
+}
+
+void FrameAdmission::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_pending.clear();
+    }
+    m_pendingCond.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_idleCond.notify_all();
+}
+
+void FrameAdmission::Drain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCond.wait(lock, [this] { return !m_running || (m_pending.empty() && m_inFlight == 0); });
+}
+
+bool FrameAdmission::Submit(const cv::Mat& image, int64_t frame_id, int64_t capture_us, int64_t deadline_us) {
+    if (deadline_us == 0 && m_config.deadline_ms > 0) {
+        deadline_us = capture_us + (int64_t)m_config.deadline_ms * 1000;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_running) {
+        return false;
+    }
+    m_stats.submitted++;
+
+    bool full = (int)m_pending.size() >= m_config.queue_size;
+    switch (m_config.policy) {
+        case LATEST_WINS:
+            if (full) {
+                m_pending.clear();
+                m_stats.replaced++;
+            }
+            break;
+        case DROP_OLDEST:
+            if (full) {
+                m_pending.pop_front();
+                m_stats.droppedOldest++;
+            }
+            break;
+        case SKIP_EVERY_NTH:
+            if (m_pending.empty()) {
+                m_backlogged = 0;
+            } else if (++m_backlogged % m_config.skip_n == 0) {
+                m_stats.skipped++;
+                return false;
+            }
+            if (full) {
+                m_stats.rejected++;
+                return false;
+            }
+            break;
+    }
+
+    m_pending.push_back(PendingFrame{image, frame_id, capture_us, deadline_us});
+    lock.unlock();
+    m_pendingCond.notify_one();
+    return true;
+}
+
+void FrameAdmission::RecordAge(int64_t age_us) {
+    if (m_ages.size() < m_config.age_samples) {
+        m_ages.push_back(age_us);
+    } else {
+        m_ages[m_ageIndex] = age_us;
+        m_ageIndex = (m_ageIndex + 1) % m_config.age_samples;
+    }
+    m_ageSumUs += age_us;
+    m_ageMaxUs = std::max(m_ageMaxUs, age_us);
+}
+
+void FrameAdmission::Worker() {
+    ApplyPlacement(m_config.worker_placement);
+    while (true) {
+        PendingFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_pendingCond.wait(lock, [this] { return !m_running || !m_pending.empty(); });
+            if (!m_running) {
+                return;
+            }
+            frame = std::move(m_pending.front());
+            m_pending.pop_front();
+            m_inFlight++;
+        }
+
+        AdmissionResult result;
+        result.frameId = frame.frameId;
+        result.captureUs = frame.captureUs;
+        result.ctx.deadlineUs = frame.deadlineUs;
+
+        bool ok = false;
+        if (frame.deadlineUs > 0 && GetTimeStamp_us() > frame.deadlineUs) {
+            result.ctx.expired = true;
+        } else if (m_onBoxes) {
+            DetectCallbacks callbacks;
+            callbacks.onBoxes = [this, &result, &frame] (const std::vector<ObjectData>& objects) {
+                AdmissionResult boxes;
+                boxes.frameId = frame.frameId;
+                boxes.captureUs = frame.captureUs;
+                boxes.ageUs = GetTimeStamp_us() - frame.captureUs;
+                boxes.ctx = result.ctx;
+                boxes.objects = objects;
+                m_onBoxes(boxes);
+                result.objects = objects;
+            };
+            callbacks.onMask = [&result] (size_t index, const ObjectData& object) {
+                result.objects[index] = object;
+            };
+            ok = m_detector.DetectStreaming(frame.image, callbacks, result.ctx);
+        } else {
+            ok = m_detector.Detect(frame.image, result.objects, result.ctx);
+        }
+        result.ageUs = GetTimeStamp_us() - frame.captureUs;
+
+        if (ok && m_onResult) {
+            m_onResult(result);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (ok) {
+                m_stats.completed++;
+                RecordAge(result.ageUs);
+            } else if (result.ctx.expired && result.ctx.inferenceUs == 0) {
+                // caught while queued or while waiting for a tensor slot
+                m_stats.expiredQueued++;
+            } else if (result.ctx.expired) {
+                m_stats.expiredInference++;
+            } else {
+                m_stats.failed++;
+            }
+            m_inFlight--;
+            if (m_pending.empty() && m_inFlight == 0) {
+                m_idleCond.notify_all();
+            }
+        }
+    }
+}
+
+AdmissionStats FrameAdmission::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    AdmissionStats stats = m_stats;
+    if (!m_ages.empty()) {
+        std::vector<int64_t> sorted = m_ages;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted] (double p) {
+            size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+            return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1] / 1000.0;
+        };
+        stats.ageP50Ms = percentile(50);
+        stats.ageP90Ms = percentile(90);
+        stats.ageP99Ms = percentile(99);
+        stats.ageMeanMs = m_ageSumUs / stats.completed / 1000.0;
+        stats.ageMaxMs = m_ageMaxUs / 1000.0;
+    }
+    return stats;
+}
@@ -0,0 +1,117 @@
+#ifndef __FRAME_ADMISSION_H__
+#define __FRAME_ADMISSION_H__
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+#include "YOLOv8s.h"
+
+typedef enum admission_policy {
+    LATEST_WINS = 0,    // one pending frame, a new frame replaces it
+    DROP_OLDEST,        // bounded queue, a new frame evicts the oldest
+    SKIP_EVERY_NTH      // while backlogged drop every Nth frame, reject when full
+}admission_policy_t;
+
+typedef struct _FrameAdmissionConfig {
+    admission_policy_t policy = LATEST_WINS;
+    int queue_size = 4;             // pending frames, LATEST_WINS always keeps 1
+    int skip_n = 2;                 // N of SKIP_EVERY_NTH
+    int workers = 1;                // threads calling Detect()
+    int deadline_ms = 0;            // default deadline after capture, 0 for none
+    size_t age_samples = 4096;      // completed frames kept for the age percentiles
+    ThreadPlacement worker_placement;   // cpus / scheduling of the worker threads
+} FrameAdmissionConfig;
+
+struct AdmissionResult {
+    int64_t frameId = 0;
+    int64_t captureUs = 0;
+    int64_t ageUs = 0;              // capture to completion
+    FrameContext ctx;
+    std::vector<ObjectData> objects;
+};
+
+struct AdmissionStats {
+    size_t submitted = 0;
+    size_t replaced = 0;            // LATEST_WINS: pending frame overwritten
+    size_t droppedOldest = 0;       // DROP_OLDEST: evicted from a full queue
+    size_t skipped = 0;             // SKIP_EVERY_NTH: shed while backlogged
+    size_t rejected = 0;            // SKIP_EVERY_NTH: queue full
+    size_t expiredQueued = 0;       // deadline passed before pre-processing
+    size_t expiredInference = 0;    // deadline passed before post-processing
+    size_t failed = 0;
+    size_t completed = 0;
+    double ageMeanMs = 0.0;
+    double ageP50Ms = 0.0;
+    double ageP90Ms = 0.0;
+    double ageP99Ms = 0.0;
+    double ageMaxMs = 0.0;
+};
+
+// Sits between a frame producer (usually a camera running at its own rate)
+// and ObjectDetection. Frames carry their capture time and a deadline;
+// the policy decides what to shed when inference falls behind, and frames
+// whose deadline passes are abandoned instead of finishing late, so
+// latency stays bounded under overload instead of building a backlog.
+class FrameAdmission {
+public:
+    typedef std::function<void(const AdmissionResult&)> ResultFn;
+
+    FrameAdmission(ObjectDetection& detector, const FrameAdmissionConfig& config, ResultFn onResult);
+    ~FrameAdmission();
+
+    // Optional early delivery: called with the post-NMS boxes (no masks yet)
+    // before the full result. Set it before Start().
+    void SetBoxesCallback(ResultFn onBoxes);
+
+    bool Start();
+    // discards pending frames and joins the workers
+    void Stop();
+    // blocks until every admitted frame has completed or been dropped
+    void Drain();
+
+    // capture_us and deadline_us are GetTimeStamp_us() values; a zero
+    // deadline means capture_us + deadline_ms. The image is referenced,
+    // not copied, so it must not be written to afterwards. Returns false
+    // if the frame was not admitted.
+    bool Submit(const cv::Mat& image, int64_t frame_id, int64_t capture_us, int64_t deadline_us = 0);
+
+    AdmissionStats GetStats() const;
+
+private:
+    struct PendingFrame {
+        cv::Mat image;
+        int64_t frameId;
+        int64_t captureUs;
+        int64_t deadlineUs;
+    };
+
+    void Worker();
+    void RecordAge(int64_t age_us);
+
+    ObjectDetection& m_detector;
+    FrameAdmissionConfig m_config;
+    ResultFn m_onResult;
+    ResultFn m_onBoxes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_pendingCond;
+    std::condition_variable m_idleCond;
+    std::deque<PendingFrame> m_pending;
+    std::vector<std::thread> m_workers;
+    bool m_running = false;
+    size_t m_inFlight = 0;
+    size_t m_backlogged = 0;
+
+    AdmissionStats m_stats;
+    std::vector<int64_t> m_ages;
+    size_t m_ageIndex = 0;
+    double m_ageSumUs = 0.0;
+    int64_t m_ageMaxUs = 0;
+};
+
+#endif // __FRAME_ADMISSION_H__
@@ -0,0 +1,300 @@
+#include <stdio.h>
+
+#include "InferenceTask.h"
+
+namespace snpetask {
+
+InferenceTask::InferenceTask()
+{
+
+}
+
+InferenceTask::~InferenceTask()
+{
+    stopSubmitThread();
+    freeSlots();
+}
+
+bool InferenceTask::deInit()
+{
+    stopSubmitThread();
+    freeSlots();
+    m_isInit = false;
+    return true;
+}
+
+bool InferenceTask::setOutputLayers(std::vector<std::string>& outputLayers)
+{
+    for (size_t i = 0; i < outputLayers.size(); i ++) {
+        m_outputLayers.push_back(outputLayers[i]);
+    }
+
+    return true;
+}
+
+bool InferenceTask::setPerformanceProfile(perf_profile_t profile)
+{
+    m_profile = profile;
+    return true;
+}
+
+size_t InferenceTask::tensorSize(const std::vector<size_t>& shape)
+{
+    if (shape.empty()) return 0;
+    size_t size = 1;
+    for (size_t dim : shape) size *= dim;
+    return size;
+}
+
+bool InferenceTask::allocateSlots(size_t slots)
+{
+    freeSlots();
+    if (slots == 0) slots = 1;
+
+    for (size_t i = 0; i < slots; i++) {
+        std::unique_ptr<TensorSlot> slot(new TensorSlot());
+        for (auto& [name, shape] : m_inputShapes) {
+            slot->inputTensors.emplace(name, new float[tensorSize(shape)]);
+        }
+        for (auto& [name, shape] : m_outputShapes) {
+            slot->outputTensors.emplace(name, new float[tensorSize(shape)]);
+        }
+        m_slots.push_back(std::move(slot));
+    }
+
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        m_freeSlots.push_back(m_slots.size() - 1 - i);
+    }
+    return true;
+}
+
+void InferenceTask::freeSlots()
+{
+    for (auto& slot : m_slots) {
+        for (auto [k, v] : slot->inputTensors) delete [] v;
+        for (auto [k, v] : slot->outputTensors) delete [] v;
+    }
+    m_slots.clear();
+    m_freeSlots.clear();
+}
+
+std::vector<size_t> InferenceTask::getInputShape(const std::string& name)
+{
+    if (isInit()) {
+        if (m_inputShapes.find(name) != m_inputShapes.end()) {
+            return m_inputShapes.at(name);
+        }
+        printf("ERROR: Can't find any input layer named %s\n", name.c_str());
+        return {};
+    } else {
+        printf("ERROR: The getInputShape() needs to be called after AICContext is initialized!\n");
+        return {};
+    }
+}
+
+std::vector<size_t> InferenceTask::getOutputShape(const std::string& name)
+{
+    if (isInit()) {
+        if (m_outputShapes.find(name) != m_outputShapes.end()) {
+            return m_outputShapes.at(name);
+        }
+        printf("ERROR: Can't find any ouput layer named %s\n", name.c_str());
+        return {};
+    } else {
+        printf("ERROR: The getOutputShape() needs to be called after AICContext is initialized!\n");
+        return {};
+    }
+}
+
+float* InferenceTask::getInputTensor(const std::string& name, size_t slot)
+{
+    if (isInit()) {
+        if (slot >= m_slots.size()) {
+            printf("ERROR: Invalid tensor slot %zu\n", slot);
+            return nullptr;
+        }
+        auto& inputTensors = m_slots[slot]->inputTensors;
+        if (inputTensors.find(name) != inputTensors.end()) {
+            return inputTensors.at(name);
+        }
+        printf("ERROR: Can't find any input tensor named %s\n", name.c_str());
+        return nullptr;
+    } else {
+        printf("ERROR: The getInputTensor() needs to be called after AICContext is initialized!\n");
+        return nullptr;
+    }
+}
+
+float* InferenceTask::getOutputTensor(const std::string& name, size_t slot)
+{
+    if (isInit()) {
+        if (slot >= m_slots.size()) {
+            printf("ERROR: Invalid tensor slot %zu\n", slot);
+            return nullptr;
+        }
+        auto& outputTensors = m_slots[slot]->outputTensors;
+        if (outputTensors.find(name) != outputTensors.end()) {
+            return outputTensors.at(name);
+        }
+        printf("ERROR: Can't find any output tensor named %s\n", name.c_str());
+        return nullptr;
+    } else {
+        printf("ERROR: The getOutputTensor() needs to be called after AICContext is initialized!\n");
+        return nullptr;
+    }
+}
+
+int64_t InferenceTask::getExecuteTime(size_t slot) const
+{
+    if (slot >= m_slots.size()) {
+        return 0;
+    }
+    return m_slots[slot]->executeUs;
+}
+
+size_t InferenceTask::acquireSlot()
+{
+    std::unique_lock<std::mutex> lock(m_slotMutex);
+    m_slotCond.wait(lock, [this] { return !m_freeSlots.empty(); });
+    size_t slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    return slot;
+}
+
+void InferenceTask::releaseSlot(size_t slot)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_slotMutex);
+        m_freeSlots.push_back(slot);
+    }
+    m_slotCond.notify_one();
+}
+
+bool InferenceTask::startSubmitThread(const ThreadPlacement& placement)
+{
+    std::lock_guard<std::mutex> lock(m_submitMutex);
+    if (m_submitRunning) {
+        return true;
+    }
+    m_submitRunning = true;
+    // reserve here rather than in the thread, so that threads placed after
+    // this returns already stay off the cpus
+    m_reservedCpus = ReserveCpus(placement);
+    m_submitThread = std::thread(&InferenceTask::submitLoop, this, placement);
+    return true;
+}
+
+void InferenceTask::stopSubmitThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        if (!m_submitRunning) {
+            return;
+        }
+        m_submitRunning = false;
+    }
+    m_submitCond.notify_all();
+    m_submitThread.join();
+
+    // fail whatever was still queued
+    std::lock_guard<std::mutex> lock(m_submitMutex);
+    for (SubmitRequest* request : m_submitQueue) {
+        request->done = true;
+    }
+    m_submitQueue.clear();
+    m_submitDoneCond.notify_all();
+
+    ReleaseCpus(m_reservedCpus);
+    m_reservedCpus.clear();
+}
+
+void InferenceTask::submitLoop(ThreadPlacement placement)
+{
+    ApplyPlacement(placement);
+    while (true) {
+        SubmitRequest* request = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_submitMutex);
+            m_submitCond.wait(lock, [this] { return !m_submitRunning || !m_submitQueue.empty(); });
+            if (!m_submitRunning) {
+                return;
+            }
+            request = m_submitQueue.front();
+            m_submitQueue.pop_front();
+        }
+
+        request->cpu = CurrentCpu();
+        bool ok = execute(request->slot);
+
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+        request->ok = ok;
+        request->done = true;
+        m_submitDoneCond.notify_all();
+    }
+}
+
+bool InferenceTask::submit(size_t slot, int* cpu)
+{
+    std::unique_lock<std::mutex> lock(m_submitMutex);
+    if (!m_submitRunning) {
+        lock.unlock();
+        if (cpu) *cpu = CurrentCpu();
+        return execute(slot);
+    }
+
+    SubmitRequest request;
+    request.slot = slot;
+    m_submitQueue.push_back(&request);
+    m_submitCond.notify_one();
+    m_submitDoneCond.wait(lock, [&request] { return request.done; });
+    if (cpu) *cpu = request.cpu;
+    return request.ok;
+}
+
+uint64_t InferenceTask::hashInput(size_t slot)
+{
+    // FNV-1a over the raw bytes of every input tensor
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto& [name, shape] : m_inputShapes) {
+        const unsigned char* data = (const unsigned char*)getInputTensor(name, slot);
+        if (data == nullptr) continue;
+        size_t bytes = tensorSize(shape) * sizeof(float);
+        for (size_t i = 0; i < bytes; i++) {
+            hash ^= data[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+std::string InferenceTask::recordPath(const std::string& dir, uint64_t hash, const std::string& name)
+{
+    std::string fileName = name;
+    std::replace(fileName.begin(), fileName.end(), '/', '_');
+    char key[32];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+    return dir + "/" + key + "." + fileName + ".raw";
+}
+
+bool InferenceTask::dumpOutputs(size_t slot, const std::string& dir)
+{
+    uint64_t hash = hashInput(slot);
+    for (auto& [name, shape] : m_outputShapes) {
+        std::string path = recordPath(dir, hash, name);
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (fp == nullptr) {
+            printf("ERROR: Can't open %s for writing\n", path.c_str());
+            return false;
+        }
+        size_t count = tensorSize(shape);
+        size_t written = fwrite(getOutputTensor(name, slot), sizeof(float), count, fp);
+        fclose(fp);
+        if (written != count) {
+            printf("ERROR: Short write to %s\n", path.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+}   // namespace snpetask
@@ -0,0 +1,123 @@
+#ifndef __INFERENCE_TASK_H__
+#define __INFERENCE_TASK_H__
+
+#include <memory>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include "utils.h"
+#include "CpuTopology.h"
+
+namespace snpetask {
+
+// Common part of the inference backends: tensor shapes and the pool of
+// tensor slots. A backend fills m_inputShapes/m_outputShapes in init(),
+// calls allocateSlots() and implements execute() on a slot.
+class InferenceTask {
+public:
+    InferenceTask();
+    virtual ~InferenceTask();
+
+    virtual bool init(const std::string& model_path, const runtime_t runtime, size_t slots = 1) = 0;
+    virtual bool deInit();
+    virtual bool execute(size_t slot = 0) = 0;
+
+    bool setOutputLayers(std::vector<std::string>& outputLayers);
+
+    // May be called before init() to pick the initial profile, or at any
+    // time afterwards to switch it.
+    virtual bool setPerformanceProfile(perf_profile_t profile);
+    perf_profile_t getPerformanceProfile() const {
+        return m_profile;
+    }
+
+    std::vector<size_t> getInputShape(const std::string& name);
+    std::vector<size_t> getOutputShape(const std::string& name);
+
+    float* getInputTensor(const std::string& name, size_t slot = 0);
+    float* getOutputTensor(const std::string& name, size_t slot = 0);
+
+    // Time the last execute() on the slot spent running, in microseconds,
+    // not counting the wait for other slots to leave the runtime.
+    int64_t getExecuteTime(size_t slot) const;
+
+    // Tensor slots let several threads share the loaded model: each caller
+    // borrows a slot, fills its input, executes and reads its output.
+    // acquireSlot() blocks until one of the slots is free.
+    size_t acquireSlot();
+    void releaseSlot(size_t slot);
+    size_t getSlotCount() const {
+        return m_slots.size();
+    }
+
+    bool isInit() {
+        return m_isInit;
+    }
+
+    // An optional dedicated thread that issues every execute(), so the
+    // inference submission can be pinned (and isolated) apart from the
+    // pre/post-processing threads. submit() runs execute() there when the
+    // thread is running and inline otherwise; cpu receives where it ran.
+    // The cpus of an isolated placement are reserved before
+    // startSubmitThread() returns and released by stopSubmitThread().
+    bool startSubmitThread(const ThreadPlacement& placement);
+    void stopSubmitThread();
+    bool submit(size_t slot, int* cpu = nullptr);
+
+    // Recorded outputs are keyed by a hash of the input tensor, which lets
+    // ReplayTask serve them back for the same preprocessed frame.
+    uint64_t hashInput(size_t slot);
+    bool dumpOutputs(size_t slot, const std::string& dir);
+
+protected:
+    struct TensorSlot {
+        std::unordered_map<std::string, float*> inputTensors;
+        std::unordered_map<std::string, float*> outputTensors;
+        int64_t executeUs = 0;
+    };
+
+    struct SubmitRequest {
+        size_t slot = 0;
+        bool done = false;
+        bool ok = false;
+        int cpu = -1;
+    };
+
+    void submitLoop(ThreadPlacement placement);
+
+    bool allocateSlots(size_t slots);
+    void freeSlots();
+    static size_t tensorSize(const std::vector<size_t>& shape);
+    static std::string recordPath(const std::string& dir, uint64_t hash, const std::string& name);
+
+    bool m_isInit = false;
+    std::atomic<perf_profile_t> m_profile { SUSTAINED_HIGH_PERFORMANCE };
+
+    std::vector<std::string> m_outputLayers;
+    std::map<std::string, std::vector<size_t> > m_inputShapes;
+    std::map<std::string, std::vector<size_t> > m_outputShapes;
+
+    std::vector<std::unique_ptr<TensorSlot> > m_slots;
+    std::vector<size_t> m_freeSlots;
+    std::mutex m_slotMutex;
+    std::condition_variable m_slotCond;
+
+    std::thread m_submitThread;
+    std::mutex m_submitMutex;
+    std::condition_variable m_submitCond;
+    std::condition_variable m_submitDoneCond;
+    std::deque<SubmitRequest*> m_submitQueue;
+    bool m_submitRunning = false;
+    std::vector<int> m_reservedCpus;
+};
+
+}    // namespace snpetask
+
+#endif    // __INFERENCE_TASK_H__
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "PerfGovernor.h"
+
+static const char* kProfileNames[] = { "burst", "high", "sustained", "balanced", "power_saver" };
+
+PerfGovernor::PerfGovernor(const PerfGovernorConfig& config, perf_profile_t initial, ApplyFn apply)
+    : m_config(config), m_apply(apply), m_profile(initial) {
+    if (m_config.window < 1) m_config.window = 1;
+    if (m_config.hold_windows < 1) m_config.hold_windows = 1;
+    if (m_config.fastest > m_config.slowest) std::swap(m_config.fastest, m_config.slowest);
+    m_profile = std::min(std::max(m_profile, m_config.fastest), m_config.slowest);
+    m_applied = m_profile;
+    m_samples.reserve(m_config.window);
+}
+
+const char* PerfGovernor::ProfileName(perf_profile_t profile) {
+    if (profile < BURST || profile > POWER_SAVER) return "unknown";
+    return kProfileNames[profile];
+}
+
+bool PerfGovernor::ParseProfile(const std::string& name, perf_profile_t& profile) {
+    for (int i = BURST; i <= POWER_SAVER; i++) {
+        if (name == kProfileNames[i]) {
+            profile = (perf_profile_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+perf_profile_t PerfGovernor::Profile() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_profile;
+}
+
+size_t PerfGovernor::Switches() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_switches;
+}
+
+// Records the decision under m_mutex; ApplyLatest() carries it out.
+void PerfGovernor::Switch(perf_profile_t profile, float observed_ms) {
+    printf("INFO : PerfGovernor p%.0f %.2f ms vs SLO %.2f ms, %s -> %s\n",
+           m_config.percentile, observed_ms, m_config.slo_ms,
+           ProfileName(m_profile), ProfileName(profile));
+    m_profile = profile;
+    m_switches++;
+}
+
+bool PerfGovernor::ApplyLatest() {
+    // Always applies the latest decision rather than the caller's own, so
+    // two switches decided back to back can't reach the backend out of
+    // order.
+    std::lock_guard<std::mutex> applyLock(m_applyMutex);
+    perf_profile_t profile = Profile();
+    if (profile == m_applied) {
+        return true;
+    }
+    if (m_apply && !m_apply(profile)) {
+        printf("ERROR: PerfGovernor failed to apply profile %s\n", ProfileName(profile));
+        // the backend is still on m_applied; undo the switch unless a newer
+        // decision has replaced it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_profile == profile) {
+            m_profile = m_applied;
+            m_switches--;
+        }
+        return false;
+    }
+    m_applied = profile;
+    return true;
+}
+
+bool PerfGovernor::OnFrame(float latency_ms) {
+    if (m_config.slo_ms <= 0.0f) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!Decide(latency_ms)) {
+            return false;
+        }
+    }
+    return ApplyLatest();
+}
+
+// Adds the sample and, when it completes a window, decides whether to
+// switch; called with m_mutex held.
+bool PerfGovernor::Decide(float latency_ms) {
+    m_samples.push_back(latency_ms);
+    if ((int)m_samples.size() < m_config.window) {
+        return false;
+    }
+
+    std::sort(m_samples.begin(), m_samples.end());
+    size_t rank = (size_t)ceil(m_config.percentile / 100.0 * m_samples.size());
+    float observed = m_samples[std::min(std::max(rank, (size_t)1), m_samples.size()) - 1];
+    m_samples.clear();
+
+    bool switched = false;
+    if (observed > m_config.upper * m_config.slo_ms) {
+        m_quietWindows = 0;
+        if (m_profile > m_config.fastest) {
+            Switch((perf_profile_t)(m_profile - 1), observed);
+            switched = true;
+        }
+    } else if (observed < m_config.lower * m_config.slo_ms) {
+        if (++m_quietWindows >= m_config.hold_windows && m_profile < m_config.slowest) {
+            m_quietWindows = 0;
+            Switch((perf_profile_t)(m_profile + 1), observed);
+            switched = true;
+        }
+    } else {
+        m_quietWindows = 0;
+    }
+    return switched;
+}
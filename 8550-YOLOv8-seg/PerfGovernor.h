@@ -0,0 +1,66 @@
+#ifndef __PERF_GOVERNOR_H__
+#define __PERF_GOVERNOR_H__
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <functional>
+
+#include "utils.h"
+
+typedef struct _PerfGovernorConfig {
+    float slo_ms = 0.0f;            // latency target, 0 disables the governor
+    int window = 30;                // frames per decision
+    float percentile = 90.0f;       // statistic compared against the SLO
+    float upper = 1.0f;             // step to a faster profile above upper * slo_ms
+    float lower = 0.6f;             // step to a slower profile below lower * slo_ms ...
+    int hold_windows = 3;           // ... for this many windows in a row
+    perf_profile_t fastest = BURST;
+    perf_profile_t slowest = POWER_SAVER;
+} PerfGovernorConfig;
+
+// Picks the most frugal performance profile that still meets a latency SLO.
+// Every `window` frames the chosen percentile of the observed latency is
+// compared with the SLO: a miss steps one profile faster straight away,
+// while stepping slower needs `hold_windows` consecutive windows well under
+// the SLO. The window restarts after every switch so that decisions only
+// use samples taken under the current profile. The profile is applied
+// through a callback, which keeps the control loop independent of the
+// backend (ReplayTask simulates a profile-dependent latency).
+class PerfGovernor {
+public:
+    typedef std::function<bool(perf_profile_t)> ApplyFn;
+
+    PerfGovernor(const PerfGovernorConfig& config, perf_profile_t initial, ApplyFn apply);
+
+    // thread-safe; returns true if the frame caused a profile switch. The
+    // callback runs on the calling thread but outside the governor's lock,
+    // so a slow switch doesn't hold up the frames of other threads.
+    bool OnFrame(float latency_ms);
+
+    perf_profile_t Profile() const;
+    size_t Switches() const;
+
+    static const char* ProfileName(perf_profile_t profile);
+    static bool ParseProfile(const std::string& name, perf_profile_t& profile);
+
+private:
+    bool Decide(float latency_ms);
+    void Switch(perf_profile_t profile, float observed_ms);
+    bool ApplyLatest();
+
+    PerfGovernorConfig m_config;
+    ApplyFn m_apply;
+
+    mutable std::mutex m_mutex;
+    perf_profile_t m_profile;
+    std::vector<float> m_samples;
+    int m_quietWindows = 0;
+    size_t m_switches = 0;
+
+    // serializes the callback; m_applied is the profile it last set
+    std::mutex m_applyMutex;
+    perf_profile_t m_applied;
+};
+
+#endif // __PERF_GOVERNOR_H__
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <thread>
+
+#include "ReplayTask.h"
+
+namespace snpetask {
+
+ReplayTask::ReplayTask(int latency_ms) : m_latencyMs(latency_ms)
+{
+    printf("INFO : Using replay backend\n");
+}
+
+ReplayTask::~ReplayTask()
+{
+
+}
+
+void ReplayTask::setInputShape(const std::string& name, const std::vector<size_t>& shape)
+{
+    m_inputShapes[name] = shape;
+}
+
+void ReplayTask::setOutputShape(const std::string& name, const std::vector<size_t>& shape)
+{
+    if (m_outputShapes.find(name) == m_outputShapes.end()) {
+        m_outputOrder.push_back(name);
+    }
+    m_outputShapes[name] = shape;
+}
+
+bool ReplayTask::init(const std::string& model_path, const runtime_t runtime, size_t slots)
+{
+    if (m_inputShapes.empty() || m_outputShapes.empty()) {
+        printf("ERROR: ReplayTask needs its tensor shapes before init()\n");
+        return false;
+    }
+    m_recordDir = model_path;
+    if (m_recordDir.empty()) {
+        printf("INFO : No record directory, synthesizing outputs\n");
+    }
+
+    allocateSlots(slots);
+    if (m_recordDir.empty() && m_outputOrder.size() >= 4) {
+        // the protos are the bulk of the outputs and carry no per-frame
+        // information, so every slot gets the same ones once; the same
+        // coefficients then decode to the same masks in any slot
+        const std::string& protoName = m_outputOrder[3];
+        size_t protoCount = tensorSize(m_outputShapes.at(protoName));
+        std::mt19937_64 gen(0);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        float* protos = m_slots[0]->outputTensors.at(protoName);
+        for (size_t j = 0; j < protoCount; j++) {
+            protos[j] = normal(gen);
+        }
+        for (size_t slot = 1; slot < m_slots.size(); slot++) {
+            memcpy(m_slots[slot]->outputTensors.at(protoName), protos, protoCount * sizeof(float));
+        }
+    }
+    m_isInit = true;
+    return true;
+}
+
+uint64_t ReplayTask::sampleInput(size_t slot)
+{
+    // FNV-1a over about kSamples floats of every input tensor. The stride is
+    // odd and not a multiple of 3 so that every channel of an interleaved
+    // image gets sampled.
+    static const size_t kSamples = 4096;
+    uint64_t hash = 14695981039346656037ULL;
+    for (auto& [name, shape] : m_inputShapes) {
+        const float* data = getInputTensor(name, slot);
+        if (data == nullptr) continue;
+        size_t count = tensorSize(shape);
+        size_t stride = std::max<size_t>(1, count / kSamples) | 1;
+        if (stride % 3 == 0) stride += 2;
+        for (size_t i = 0; i < count; i += stride) {
+            uint32_t bits;
+            memcpy(&bits, &data[i], sizeof(bits));
+            hash ^= bits;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+bool ReplayTask::load(size_t slot, uint64_t hash)
+{
+    for (auto& [name, shape] : m_outputShapes) {
+        std::string path = recordPath(m_recordDir, hash, name);
+        FILE* fp = fopen(path.c_str(), "rb");
+        if (fp == nullptr) {
+            printf("ERROR: No recorded output %s\n", path.c_str());
+            return false;
+        }
+        size_t count = tensorSize(shape);
+        size_t read = fread(getOutputTensor(name, slot), sizeof(float), count, fp);
+        fclose(fp);
+        if (read != count) {
+            printf("ERROR: Truncated recorded output %s\n", path.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReplayTask::synthesize(size_t slot, uint64_t hash)
+{
+    // the protos were filled once by init()
+    bool yolo = m_outputOrder.size() >= 4;
+    for (auto& [name, shape] : m_outputShapes) {
+        if (yolo && name == m_outputOrder[3]) continue;
+        memset(getOutputTensor(name, slot), 0, tensorSize(shape) * sizeof(float));
+    }
+    if (!yolo) {
+        return;
+    }
+
+    // scores [1, labels, grids], boxes [1, 4, grids], coefficients [1, 32, grids], protos [1, 160, 160, 32]
+    const std::vector<size_t>& scoreShape = m_outputShapes.at(m_outputOrder[0]);
+    const std::vector<size_t>& inputShape = m_inputShapes.begin()->second;
+    size_t labels = scoreShape[1];
+    size_t grids = scoreShape[2];
+    float inputHeight = inputShape[1];
+    float inputWidth = inputShape[2];
+    float* scores = getOutputTensor(m_outputOrder[0], slot);
+    float* boxes = getOutputTensor(m_outputOrder[1], slot);
+    float* coeffs = getOutputTensor(m_outputOrder[2], slot);
+    size_t coeffCount = m_outputShapes.at(m_outputOrder[2])[1];
+
+    // the same frame always yields the same objects
+    std::mt19937_64 gen(hash);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    int objects = 1 + gen() % 8;
+    for (int k = 0; k < objects; k++) {
+        size_t i = gen() % grids;
+        size_t label = gen() % labels;
+        float w = 32.0f + unit(gen) * inputWidth / 3;
+        float h = 32.0f + unit(gen) * inputHeight / 3;
+        scores[label * grids + i] = 0.6f + 0.35f * unit(gen);
+        boxes[0 * grids + i] = w / 2 + unit(gen) * (inputWidth - w);
+        boxes[1 * grids + i] = h / 2 + unit(gen) * (inputHeight - h);
+        boxes[2 * grids + i] = w;
+        boxes[3 * grids + i] = h;
+        for (size_t j = 0; j < coeffCount; j++) {
+            coeffs[j * grids + i] = normal(gen);
+        }
+    }
+}
+
+int ReplayTask::simulatedLatencyMs(int latency_ms, perf_profile_t profile)
+{
+    // latency_ms is the SUSTAINED_HIGH_PERFORMANCE figure
+    static const float factors[] = { 0.7f, 0.85f, 1.0f, 1.4f, 2.2f };
+    int index = std::min(std::max((int)profile, 0), 4);
+    return (int)(latency_ms * factors[index] + 0.5f);
+}
+
+bool ReplayTask::setPerformanceProfile(perf_profile_t profile)
+{
+    std::lock_guard<std::mutex> lock(m_executeMutex);
+    return InferenceTask::setPerformanceProfile(profile);
+}
+
+bool ReplayTask::execute(size_t slot)
+{
+    if (slot >= m_slots.size()) {
+        printf("ERROR: Invalid tensor slot %zu\n", slot);
+        return false;
+    }
+
+    // recordings are keyed by the whole input; synthetic outputs only need
+    // the same frame to give the same objects, which a sample provides
+    uint64_t hash = m_recordDir.empty() ? sampleInput(slot) : hashInput(slot);
+    {
+        // only the simulated accelerator time counts as execution, as it is
+        // what the profile changes; the governor would otherwise see the
+        // host-side work below as missed latency
+        std::lock_guard<std::mutex> lock(m_executeMutex);
+        int64_t start = GetTimeStamp_us();
+        int latency = simulatedLatencyMs(m_latencyMs, m_profile);
+        if (latency > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+        }
+        m_slots[slot]->executeUs = GetTimeStamp_us() - start;
+    }
+
+    bool ok = true;
+    if (!m_recordDir.empty()) {
+        ok = load(slot, hash);
+    } else {
+        synthesize(slot, hash);
+    }
+    return ok;
+}
+
+}   // namespace snpetask
@@ -0,0 +1,49 @@
+#ifndef __REPLAY_TASK_H__
+#define __REPLAY_TASK_H__
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <mutex>
+
+#include "InferenceTask.h"
+
+namespace snpetask {
+
+// Inference backend that runs without SNPE. With a model_path it serves
+// outputs recorded by InferenceTask::dumpOutputs() for the same input;
+// with an empty model_path it synthesizes YOLOv8-seg shaped outputs
+// (scores, boxes, mask coefficients, protos in the order given to
+// setOutputShape()). execute() sleeps for the configured latency to stand
+// in for the accelerator, one frame at a time like SNPETask; the latency
+// scales with the performance profile so that PerfGovernor can be
+// exercised without hardware.
+class ReplayTask : public InferenceTask {
+public:
+    explicit ReplayTask(int latency_ms = 0);
+    ~ReplayTask();
+
+    void setInputShape(const std::string& name, const std::vector<size_t>& shape);
+    void setOutputShape(const std::string& name, const std::vector<size_t>& shape);
+
+    bool init(const std::string& model_path, const runtime_t runtime, size_t slots = 1) override;
+    bool execute(size_t slot = 0) override;
+    bool setPerformanceProfile(perf_profile_t profile) override;
+
+    // simulated inference time under the given profile
+    static int simulatedLatencyMs(int latency_ms, perf_profile_t profile);
+
+private:
+    bool load(size_t slot, uint64_t hash);
+    void synthesize(size_t slot, uint64_t hash);
+    uint64_t sampleInput(size_t slot);
+
+    std::string m_recordDir;
+    int m_latencyMs;
+    std::vector<std::string> m_outputOrder;
+    std::mutex m_executeMutex;
+};
+
+}    // namespace snpetask
+
+#endif    // __REPLAY_TASK_H__
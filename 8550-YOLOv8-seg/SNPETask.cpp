@@ -15,7 +15,7 @@ static size_t calcSizeFromDims(const zdl::DlSystem::Dimension* dims, size_t rank
 
 
 static void createUserBuffer(zdl::DlSystem::UserBufferMap& userBufferMap,
-                      std::unordered_map<std::string, float*>& applicationBuffers,
+                      float* buffer,
                       std::vector<std::unique_ptr<zdl::DlSystem::IUserBuffer>>& snpeUserBackedBuffers,
                       const zdl::DlSystem::TensorShape& bufferShape,
                       const char* name)
@@ -30,15 +30,12 @@ static void createUserBuffer(zdl::DlSystem::UserBufferMap& userBufferMap,
     }
     // const size_t bufferElementSize = sizeof(float);
     size_t bufSize = calcSizeFromDims(bufferShape.getDimensions(), bufferShape.rank(), 1);
-    float* buffer = new float[bufSize];
 
     // set the buffer encoding type
     zdl::DlSystem::UserBufferEncodingFloat userBufferEncodingFloat;
-    // create user-backed storage to load input data onto it
-    applicationBuffers.emplace(name, buffer);
-    // create SNPE user buffer from the user-backed buffer
+    // create SNPE user buffer from the user-backed buffer owned by the tensor slot
     zdl::DlSystem::IUserBufferFactory& ubFactory = zdl::SNPE::SNPEFactory::getUserBufferFactory();
-    snpeUserBackedBuffers.push_back(ubFactory.createUserBuffer(applicationBuffers.at(name),
+    snpeUserBackedBuffers.push_back(ubFactory.createUserBuffer(buffer,
                                                                 bufSize,
                                                                 strides,
                                                                 &userBufferEncodingFloat));
@@ -46,6 +43,23 @@ static void createUserBuffer(zdl::DlSystem::UserBufferMap& userBufferMap,
     userBufferMap.add(name, snpeUserBackedBuffers.back().get());
 }
 
+static zdl::DlSystem::PerformanceProfile_t toSNPEProfile(perf_profile_t profile)
+{
+    switch (profile) {
+        case BURST:
+            return zdl::DlSystem::PerformanceProfile_t::BURST;
+        case HIGH_PERFORMANCE:
+            return zdl::DlSystem::PerformanceProfile_t::HIGH_PERFORMANCE;
+        case BALANCED:
+            return zdl::DlSystem::PerformanceProfile_t::BALANCED;
+        case POWER_SAVER:
+            return zdl::DlSystem::PerformanceProfile_t::POWER_SAVER;
+        case SUSTAINED_HIGH_PERFORMANCE:
+        default:
+            return zdl::DlSystem::PerformanceProfile_t::SUSTAINED_HIGH_PERFORMANCE;
+    }
+}
+
 SNPETask::SNPETask()
 {
     static zdl::DlSystem::Version_t version = zdl::SNPE::SNPEFactory::getLibraryVersion();
@@ -57,7 +71,7 @@ SNPETask::~SNPETask()
 
 }
 
-bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
+bool SNPETask::init(const std::string& model_path, const runtime_t runtime, size_t slots)
 {
     switch (runtime) {
         case CPU:
@@ -85,7 +99,7 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
         m_runtime = zdl::DlSystem::Runtime_t::CPU;
     }
 
-    zdl::DlSystem::PerformanceProfile_t profile = zdl::DlSystem::PerformanceProfile_t::SUSTAINED_HIGH_PERFORMANCE;
+    zdl::DlSystem::PerformanceProfile_t profile = toSNPEProfile(m_profile);
 
     m_container = zdl::DlContainer::IDlContainer::open(model_path);
 
@@ -94,8 +108,13 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
     // runtimeList.add(zdl::DlSystem::Runtime_t::DSP);
     runtimeList.add(zdl::DlSystem::Runtime_t::CPU);
 
+    zdl::DlSystem::StringList outputLayers;
+    for (auto& layer : m_outputLayers) {
+        outputLayers.append(layer.c_str());
+    }
+
     zdl::SNPE::SNPEBuilder snpeBuilder(m_container.get());
-    m_snpe = snpeBuilder.setOutputLayers(m_outputLayers)
+    m_snpe = snpeBuilder.setOutputLayers(outputLayers)
        .setRuntimeProcessorOrder(runtimeList)
        .setPerformanceProfile(profile)
        .setUseUserSuppliedBuffers(false)
@@ -112,7 +131,7 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
     if (!inputNamesOpt) throw std::runtime_error("Error obtaining input tensor names");
     const zdl::DlSystem::StringList& inputNames = *inputNamesOpt;
 
-    // create SNPE user buffers for each application storage buffer
+    std::map<std::string, zdl::DlSystem::TensorShape> bufferShapes;
     for (const char* name : inputNames) {
         // get attributes of buffer by name
         auto bufferAttributesOpt = m_snpe->getInputOutputBufferAttributes(name);
@@ -127,8 +146,7 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
             tensorShape.push_back(bufferShape[j]);
         }
         m_inputShapes.emplace(name, tensorShape);
-
-        createUserBuffer(m_inputUserBufferMap, m_inputTensors, m_inputUserBuffers, bufferShape, name);
+        bufferShapes.emplace(name, bufferShape);
     }
 
     // get output tensor names of the network that need to be populated
@@ -136,7 +154,6 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
     if (!outputNamesOpt) throw std::runtime_error("Error obtaining output tensor names");
     const zdl::DlSystem::StringList& outputNames = *outputNamesOpt;
 
-    // create SNPE user buffers for each application storage buffer
     for (const char* name : outputNames) {
         // get attributes of buffer by name
         auto bufferAttributesOpt = m_snpe->getInputOutputBufferAttributes(name);
@@ -152,8 +169,21 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
             tensorShape.push_back(bufferShape[j]);
         }
         m_outputShapes.emplace(name, tensorShape);
+        bufferShapes.emplace(name, bufferShape);
+    }
 
-        createUserBuffer(m_outputUserBufferMap, m_outputTensors, m_outputUserBuffers, bufferShape, name);
+    allocateSlots(slots);
+
+    // create SNPE user buffers for each application storage buffer
+    for (auto& slot : m_slots) {
+        std::unique_ptr<UserBuffers> buffers(new UserBuffers());
+        for (auto [name, buffer] : slot->inputTensors) {
+            createUserBuffer(buffers->inputUserBufferMap, buffer, buffers->inputUserBuffers, bufferShapes.at(name), name.c_str());
+        }
+        for (auto [name, buffer] : slot->outputTensors) {
+            createUserBuffer(buffers->outputUserBufferMap, buffer, buffers->outputUserBuffers, bufferShapes.at(name), name.c_str());
+        }
+        m_userBuffers.push_back(std::move(buffers));
     }
 
     m_isInit = true;
@@ -163,95 +193,56 @@ bool SNPETask::init(const std::string& model_path, const runtime_t runtime)
 
 bool SNPETask::deInit()
 {
+    // the submit thread may still be executing on m_snpe
+    stopSubmitThread();
     if (nullptr != m_snpe) {
         m_snpe.reset(nullptr);
     }
 
-    for (auto [k, v] : m_inputTensors) delete [] v;
-    for (auto [k, v] : m_outputTensors) delete [] v;
-    return true;
-}
-
-bool SNPETask::setOutputLayers(std::vector<std::string>& outputLayers)
-{
-    for (size_t i = 0; i < outputLayers.size(); i ++) {
-        m_outputLayers.append(outputLayers[i].c_str());
-    }
-
-    return true;
+    m_userBuffers.clear();
+    return InferenceTask::deInit();
 }
 
-std::vector<size_t> SNPETask::getInputShape(const std::string& name)
+bool SNPETask::setPerformanceProfile(perf_profile_t profile)
 {
-    if (isInit()) {
-        if (m_inputShapes.find(name) != m_inputShapes.end()) {
-            return m_inputShapes.at(name);
-        }
-        printf("ERROR: Can't find any input layer named %s\n", name.c_str());
-        return {};
-    } else {
-        printf("ERROR: The getInputShape() needs to be called after AICContext is initialized!\n");
-        return {};
-    }
-}
-
-std::vector<size_t> SNPETask::getOutputShape(const std::string& name)
-{
-    // printf("!!! getOutputShape get name [%s]\n", name.c_str());
-    if (isInit()) {
-        if (m_outputShapes.find(name) != m_outputShapes.end()) {
-            return m_outputShapes.at(name);
-        }
-        printf("ERROR: Can't find any ouput layer named %s\n", name.c_str());
-        return {};
-    } else {
-        printf("ERROR: The getOutputShape() needs to be called after AICContext is initialized!\n");
-        return {};
-    }
-}
-
-float* SNPETask::getInputTensor(const std::string& name)
-{
-    if (isInit()) {
-        if (m_inputTensors.find(name) != m_inputTensors.end()) {
-            return m_inputTensors.at(name);
-        }
-        printf("ERROR: Can't find any input tensor named %s\n", name.c_str());
-        return nullptr;
-    } else {
-        printf("ERROR: The getInputTensor() needs to be called after AICContext is initialized!\n");
-        return nullptr;
-    }
-}
-
-float* SNPETask::getOutputTensor(const std::string& name)
-{
-    if (isInit()) {
-        if (m_outputTensors.find(name) != m_outputTensors.end()) {
-            return m_outputTensors.at(name);
-        }
-        printf("ERROR: Can't find any output tensor named %s\n", name.c_str());
-        return nullptr;
-    } else {
-        printf("ERROR: The getOutputTensor() needs to be called after AICContext is initialized!\n");
-        return nullptr;
+    // switching must not race with a running execute()
+    std::lock_guard<std::mutex> lock(m_executeMutex);
+    if (nullptr != m_snpe && !m_snpe->setPerformanceProfile(toSNPEProfile(profile))) {
+        printf("ERROR: SNPE setPerformanceProfile failed: %s\n", zdl::DlSystem::getLastErrorString());
+        return false;
     }
+    return InferenceTask::setPerformanceProfile(profile);
 }
 
-bool SNPETask::execute()
+bool SNPETask::execute(size_t slot)
 {
-    // if (!m_snpe->execute(m_inputUserBufferMap, m_outputUserBufferMap)) {
+    // if (!m_snpe->execute(m_userBuffers[slot]->inputUserBufferMap, m_userBuffers[slot]->outputUserBufferMap)) {
     //     printf("ERROR: SNPETask execute failed: %s\n", zdl::DlSystem::getLastErrorString());
     //     return false;
     // }
     // return true;
 
+    if (slot >= m_slots.size()) {
+        printf("ERROR: Invalid tensor slot %zu\n", slot);
+        return false;
+    }
+    TensorSlot& tensors = *m_slots[slot];
+
+    const std::string& inputName = m_inputShapes.begin()->first;
+    const std::vector<size_t>& inputShape = m_inputShapes.begin()->second;
+    size_t inputSize = 1;
+    for (size_t dim : inputShape) inputSize *= dim;
+
     std::unique_ptr<zdl::DlSystem::ITensor> inputTensor;
-    inputTensor = zdl::SNPE::SNPEFactory::getTensorFactory().createTensor(m_inputShapes["images"]);
-    std::copy(m_inputTensors["images"], m_inputTensors["images"]+640*640*3, inputTensor->begin());
+    inputTensor = zdl::SNPE::SNPEFactory::getTensorFactory().createTensor(inputShape);
+    std::copy(tensors.inputTensors[inputName], tensors.inputTensors[inputName]+inputSize, inputTensor->begin());
 
     zdl::DlSystem::TensorMap outputTensorMap;
 
+    // the output tensors belong to SNPE and are reused by the next execute(),
+    // so they are copied into the slot before the lock is released
+    std::lock_guard<std::mutex> lock(m_executeMutex);
+    int64_t start = GetTimeStamp_us();
     if (!m_snpe->execute(inputTensor.get(), outputTensorMap)) {
         printf("ERROR:SNPETask execute failed: %s\n", zdl::DlSystem::getLastErrorString());
         return false;
@@ -263,10 +254,11 @@ bool SNPETask::execute()
         int ptr = 0;
         auto tensorPtr = outputTensorMap.getTensor(name);
         for (auto i:*(tensorPtr)) {
-            *(m_outputTensors[std::string(name)] + ptr) = i;
+            *(tensors.outputTensors[std::string(name)] + ptr) = i;
             ptr++;
         }
     }
+    tensors.executeUs = GetTimeStamp_us() - start;
 
     return true;
 }
@@ -4,7 +4,6 @@
 #include <memory>
 #include <vector>
 #include <map>
-#include <unordered_map>
 #include <string>
 
 #include "SNPE/SNPE.hpp"
@@ -17,48 +16,37 @@
 #include "DlSystem/TensorShape.hpp"
 #include "DlContainer/IDlContainer.hpp"
 
-#include "utils.h"
+#include "InferenceTask.h"
 
 namespace snpetask {
 
-class SNPETask {
+class SNPETask : public InferenceTask {
 public:
     SNPETask();
     ~SNPETask();
 
-    bool init(const std::string& model_path, const runtime_t runtime);
-    bool deInit();
-    bool setOutputLayers(std::vector<std::string>& outputLayers);
+    bool init(const std::string& model_path, const runtime_t runtime, size_t slots = 1) override;
+    bool deInit() override;
+    bool setPerformanceProfile(perf_profile_t profile) override;
 
-    std::vector<size_t> getInputShape(const std::string& name);
-    std::vector<size_t> getOutputShape(const std::string& name);
-
-    float* getInputTensor(const std::string& name);
-    float* getOutputTensor(const std::string& name);
-
-    bool isInit() {
-        return m_isInit;
-    }
-
-    bool execute();
+    bool execute(size_t slot = 0) override;
 
 private:
-    bool m_isInit = false;
+    struct UserBuffers {
+        std::vector<std::unique_ptr<zdl::DlSystem::IUserBuffer> > inputUserBuffers;
+        std::vector<std::unique_ptr<zdl::DlSystem::IUserBuffer> > outputUserBuffers;
+        zdl::DlSystem::UserBufferMap inputUserBufferMap;
+        zdl::DlSystem::UserBufferMap outputUserBufferMap;
+    };
 
     std::unique_ptr<zdl::DlContainer::IDlContainer> m_container;
     std::unique_ptr<zdl::SNPE::SNPE> m_snpe;
     zdl::DlSystem::Runtime_t m_runtime;
-    zdl::DlSystem::StringList m_outputLayers;
-
-    std::map<std::string, std::vector<size_t> > m_inputShapes;
-    std::map<std::string, std::vector<size_t> > m_outputShapes;
 
-    std::vector<std::unique_ptr<zdl::DlSystem::IUserBuffer> > m_inputUserBuffers;
-    std::vector<std::unique_ptr<zdl::DlSystem::IUserBuffer> > m_outputUserBuffers;
-    zdl::DlSystem::UserBufferMap m_inputUserBufferMap;
-    zdl::DlSystem::UserBufferMap m_outputUserBufferMap;
-    std::unordered_map<std::string, float*> m_inputTensors;
-    std::unordered_map<std::string, float*> m_outputTensors;
+    // SNPE views of the tensor slots, one entry per slot
+    std::vector<std::unique_ptr<UserBuffers> > m_userBuffers;
+    // SNPE::execute() is not reentrant, only the pre/post-processing around it is
+    std::mutex m_executeMutex;
 };
 
 }    // namespace snpetask
@@ -4,6 +4,10 @@
 #include <opencv2/opencv.hpp>
 
 #include "YOLOv8s.h"
+#include "ReplayTask.h"
+#ifdef USE_SNPE
+#include "SNPETask.h"
+#endif
 
 static float sigmoid(float x) { 
     return 1.0 / (1.0 + expf(-x));
@@ -22,26 +26,63 @@ ObjectDetection::~ObjectDetection() {
 }
 
 bool ObjectDetection::Initialize(const ObjectDetectionConfig& config) {
-    m_task = std::move(std::unique_ptr<snpetask::SNPETask>(new snpetask::SNPETask()));
     m_inputLayers = config.inputLayers;
     m_outputLayers = config.outputLayers;
     m_outputTensors = config.outputTensors;
+    m_recordPath = config.record_path;
     m_labels = config.labels;
     m_grids = config.grids;
+
+    if (config.runtime == REPLAY) {
+        if (m_inputLayers.size() < 1 || m_outputTensors.size() < 4) {
+            printf("ERROR: REPLAY runtime needs 1 input layer and 4 output tensors.\n");
+            return false;
+        }
+        snpetask::ReplayTask* replay = new snpetask::ReplayTask(config.replay_latency_ms);
+        replay->setInputShape(m_inputLayers[0], {1, 640, 640, 3});
+        replay->setOutputShape(m_outputTensors[0], {1, (size_t)m_labels, (size_t)m_grids});
+        replay->setOutputShape(m_outputTensors[1], {1, 4, (size_t)m_grids});
+        replay->setOutputShape(m_outputTensors[2], {1, 32, (size_t)m_grids});
+        replay->setOutputShape(m_outputTensors[3], {1, 160, 160, 32});
+        m_task.reset(replay);
+    } else {
+#ifdef USE_SNPE
+        m_task.reset(new snpetask::SNPETask());
+#else
+        printf("ERROR: Built without SNPE, only the REPLAY runtime is available.\n");
+        return false;
+#endif
+    }
     m_task->setOutputLayers(m_outputLayers);
+    m_task->setPerformanceProfile(config.profile);
 
-    if (!m_task->init(config.model_path, config.runtime)) {
+    if (!m_task->init(config.model_path, config.runtime, std::max(config.slots, 1))) {
         printf("ERROR: Can't init snpetask instance.\n");
         return false;
     }
 
+    if (config.submit_placement.enabled) {
+        m_task->startSubmitThread(config.submit_placement);
+    }
+
+    if (config.governor.slo_ms > 0) {
+        snpetask::InferenceTask* task = m_task.get();
+        m_governor.reset(new PerfGovernor(config.governor, config.profile, [task] (perf_profile_t profile) {
+            return task->setPerformanceProfile(profile);
+        }));
+        // the governor clamps the initial profile into its range
+        m_task->setPerformanceProfile(m_governor->Profile());
+    }
+
     m_output = new float[m_grids * m_labels];
     m_isInit = true;
     return true;
 }
 
 bool ObjectDetection::DeInitialize() {
+    m_governor.reset(nullptr);
     if (m_task) {
+        m_task->stopSubmitThread();
         m_task->deInit();
         m_task.reset(nullptr);
     }
@@ -53,21 +94,22 @@ bool ObjectDetection::DeInitialize() {
     return true;
 }
 
-bool ObjectDetection::PreProcess(const cv::Mat& image) {
+bool ObjectDetection::PreProcess(const cv::Mat& image, FrameContext& ctx) {
     auto inputShape = m_task->getInputShape(m_inputLayers[0]);
     size_t batch = inputShape[0];
     size_t inputHeight = inputShape[1];
     size_t inputWidth = inputShape[2];
     size_t channel = inputShape[3];
-    orin_cols = image.cols;
-    orin_rows = image.rows;
+    ctx.orinCols = image.cols;
+    ctx.orinRows = image.rows;
 
-    if (m_task->getInputTensor(m_inputLayers[0]) == nullptr) {
+    float* inputTensor = m_task->getInputTensor(m_inputLayers[0], ctx.slot);
+    if (inputTensor == nullptr) {
         printf("ERROR: Empty input tensor\n");
         return false;
     }
 
-    cv::Mat input(inputHeight, inputWidth, CV_32FC3, m_task->getInputTensor(m_inputLayers[0]));
+    cv::Mat input(inputHeight, inputWidth, CV_32FC3, inputTensor);
     if (image.empty()) {
         printf("ERROR: Invalid image!\n");
         return false;
@@ -75,14 +117,14 @@ bool ObjectDetection::PreProcess(const cv::Mat& image) {
     int imgWidth = image.cols;
     int imgHeight = image.rows;
 
-    m_scale = std::min(inputHeight /(float)imgHeight, inputWidth / (float)imgWidth);
-    int scaledWidth = imgWidth * m_scale;
-    int scaledHeight = imgHeight * m_scale;
-    m_xOffset = (inputWidth - scaledWidth) / 2;
-    m_yOffset = (inputHeight - scaledHeight) / 2;
+    ctx.scale = std::min(inputHeight /(float)imgHeight, inputWidth / (float)imgWidth);
+    int scaledWidth = imgWidth * ctx.scale;
+    int scaledHeight = imgHeight * ctx.scale;
+    ctx.xOffset = (inputWidth - scaledWidth) / 2;
+    ctx.yOffset = (inputHeight - scaledHeight) / 2;
 
     cv::Mat inputMat(inputHeight, inputWidth, CV_8UC3, cv::Scalar(128, 128, 128));
-    cv::Mat roiMat(inputMat, cv::Rect(m_xOffset, m_yOffset, scaledWidth, scaledHeight));
+    cv::Mat roiMat(inputMat, cv::Rect(ctx.xOffset, ctx.yOffset, scaledWidth, scaledHeight));
     cv::resize(image, roiMat, cv::Size(scaledWidth, scaledHeight), cv::INTER_LINEAR);
     inputMat.convertTo(input, CV_32FC3);
     input /= 255.0f;
@@ -90,13 +132,86 @@ bool ObjectDetection::PreProcess(const cv::Mat& image) {
 }
 
 bool ObjectDetection::Detect(const cv::Mat& image, std::vector<ObjectData>& results) {
-    PreProcess(image);
-    int64_t start = GetTimeStamp_ms();
-    if (!m_task->execute()) {
+    FrameContext ctx;
+    return Detect(image, results, ctx);
+}
+
+bool ObjectDetection::Detect(const cv::Mat& image, std::vector<ObjectData>& results, FrameContext& ctx) {
+    return Run(image, results, ctx, nullptr);
+}
+
+bool ObjectDetection::DetectStreaming(const cv::Mat& image, const DetectCallbacks& callbacks, FrameContext& ctx) {
+    std::vector<ObjectData> results;
+    // the slot is already released when onDone runs
+    bool ok = Run(image, results, ctx, &callbacks);
+    if (callbacks.onDone) {
+        callbacks.onDone(ok);
+    }
+    return ok;
+}
+
+bool ObjectDetection::Run(const cv::Mat& image, std::vector<ObjectData>& results, FrameContext& ctx, const DetectCallbacks* callbacks) {
+    if (!m_isInit) {
+        printf("ERROR: ObjectDetection is not initialized.\n");
+        return false;
+    }
+
+    int64_t t0 = GetTimeStamp_us();
+    // hand the slot back on every return path
+    struct SlotGuard {
+        snpetask::InferenceTask* task;
+        size_t slot;
+        ~SlotGuard() { task->releaseSlot(slot); }
+    } guard { m_task.get(), m_task->acquireSlot() };
+    ctx.slot = guard.slot;
+
+    int64_t t1 = GetTimeStamp_us();
+    ctx.slotWaitUs = t1 - t0;
+    ctx.expired = false;
+    if (ctx.deadlineUs > 0 && t1 > ctx.deadlineUs) {
+        ctx.expired = true;
+        return false;
+    }
+    ctx.preprocessCpu = CurrentCpu();
+    if (!PreProcess(image, ctx)) {
+        return false;
+    }
+    int64_t t2 = GetTimeStamp_us();
+    ctx.preprocessUs = t2 - t1;
+    if (!m_task->submit(ctx.slot, &ctx.inferenceCpu)) {
         printf("ERROR: SNPETask execute failed.\n");
         return false;
     }
-    PostProcess(results, GetTimeStamp_ms() - start);
+    int64_t t3 = GetTimeStamp_us();
+    ctx.inferenceUs = t3 - t2;
+    ctx.executeUs = m_task->getExecuteTime(ctx.slot);
+    if (!m_recordPath.empty()) {
+        m_task->dumpOutputs(ctx.slot, m_recordPath);
+    }
+    if (ctx.deadlineUs > 0 && t3 > ctx.deadlineUs) {
+        // still a (lower bound) latency sample, overload is when the governor needs them most
+        if (m_governor) m_governor->OnFrame((ctx.preprocessUs + ctx.executeUs) / 1000.0f);
+        ctx.expired = true;
+        return false;
+    }
+
+    ctx.postprocessCpu = CurrentCpu();
+    DecodeBoxes(ctx, results);
+    ctx.boxesUs = GetTimeStamp_us() - t0;
+    if (callbacks && callbacks->onBoxes) {
+        callbacks->onBoxes(results);
+    }
+    DecodeMasks(ctx, results, callbacks);
+    int64_t t4 = GetTimeStamp_us();
+    ctx.postprocessUs = t4 - t3;
+    m_preprocessCpus.Record(ctx.preprocessCpu);
+    m_inferenceCpus.Record(ctx.inferenceCpu);
+    m_postprocessCpus.Record(ctx.postprocessCpu);
+    if (m_governor) {
+        // service time only: waiting for a slot or for the runtime (execute
+        // lock, submit queue) is queueing, not something a profile fixes
+        m_governor->OnFrame((ctx.preprocessUs + ctx.executeUs + ctx.postprocessUs) / 1000.0f);
+    }
     return true;
 }
 
@@ -125,10 +240,10 @@ void ObjectDetection::get_mask(const cv::Mat& mask_info, const cv::Mat& mask_dat
 	mast_out = dest > 0.5;
 }
 
-bool ObjectDetection::PostProcess(std::vector<ObjectData> &results, int64_t time) {
+bool ObjectDetection::DecodeBoxes(const FrameContext& ctx, std::vector<ObjectData> &results) {
     auto outputShape = m_task->getOutputShape(m_outputTensors[0]);
-    const float *predOutput = m_task->getOutputTensor(m_outputTensors[0]);
-    const float *output = m_task->getOutputTensor(m_outputTensors[1]);
+    const float *predOutput = m_task->getOutputTensor(m_outputTensors[0], ctx.slot);
+    const float *output = m_task->getOutputTensor(m_outputTensors[1], ctx.slot);
     int B_ = outputShape[0];
     int H_ = outputShape[1];
     int W_ = outputShape[2];
@@ -154,12 +269,12 @@ bool ObjectDetection::PostProcess(std::vector<ObjectData> &results, int64_t time
             float h = *(output+3*W_+i);
             x = x-0.5*w;
             y = y-0.5*h;
-            x -= m_xOffset;
-            y -= m_yOffset;
-            w /= m_scale;
-            h /= m_scale;
-            x /= m_scale;
-            y /= m_scale;
+            x -= ctx.xOffset;
+            y -= ctx.yOffset;
+            w /= ctx.scale;
+            h /= ctx.scale;
+            x /= ctx.scale;
+            y /= ctx.scale;
             
             ObjectData rect;
             rect.bbox.x = x;
@@ -180,20 +295,40 @@ bool ObjectDetection::PostProcess(std::vector<ObjectData> &results, int64_t time
         }
     }
 
-    float *info = m_task->getOutputTensor(m_outputTensors[2]);
-    float *mask = m_task->getOutputTensor(m_outputTensors[3]);
+    // clip to the original image so the boxes are final before any mask exists;
+    // a box that lies entirely in the letterbox padding clips to nothing
+    size_t kept = 0;
+    for (auto& i:results) {
+        int maxX = std::min(i.bbox.x + i.bbox.width, ctx.orinCols);
+        int maxY = std::min(i.bbox.y + i.bbox.height, ctx.orinRows);
+        i.bbox.x = std::max(i.bbox.x, 0);
+        i.bbox.y = std::max(i.bbox.y, 0);
+        i.bbox.width = maxX - i.bbox.x;
+        i.bbox.height = maxY - i.bbox.y;
+        if (i.bbox.width > 0 && i.bbox.height > 0) {
+            results[kept++] = i;
+        }
+    }
+    results.resize(kept);
+    return true;
+}
+
+bool ObjectDetection::DecodeMasks(const FrameContext& ctx, std::vector<ObjectData> &results, const DetectCallbacks* callbacks) {
+    float *info = m_task->getOutputTensor(m_outputTensors[2], ctx.slot);
+    float *mask = m_task->getOutputTensor(m_outputTensors[3], ctx.slot);
     
-    float* mask_input = (float*)malloc(32*160*160*sizeof(float));
+    std::vector<float> mask_input(32*160*160);
     for (int i=0; i<32; i++) {
         for (int j=0;j<160*160; j++) {
-            *(mask_input+i*160*160+j) = *(mask+j*32+i);
+            mask_input[i*160*160+j] = *(mask+j*32+i);
         }
     }
 
     std::vector<int> mask_sz = { 1,32,160,160 };
-	cv::Mat output1 = cv::Mat(mask_sz, CV_32F, mask_input);
+	cv::Mat output1 = cv::Mat(mask_sz, CV_32F, mask_input.data());
 
-    for (auto& i:results) {
+    for (size_t k = 0; k < results.size(); k++) {
+        auto& i = results[k];
         std::vector<float> dat {};
         for (int j=0; j<32; j++) {
             dat.push_back(*(info+j*8400+i.index));
@@ -203,18 +338,15 @@ bool ObjectDetection::PostProcess(std::vector<ObjectData> &results, int64_t time
         cv::Mat mask_4x;
         cv::resize(i.mask, mask_4x, cv::Size(640,640));
         cv::Mat mask_ori_size;
-        cv::resize(mask_4x(cv::Rect(m_xOffset, m_yOffset, 640-2*m_xOffset, 640-2*m_yOffset)), mask_ori_size, cv::Size(orin_cols, orin_rows));
-        cv::Mat blackImage(cv::Size(orin_cols, orin_rows), CV_32F, cv::Scalar(0, 0, 0));
-        int maxX = std::min(i.bbox.x + i.bbox.width, orin_cols);
-        int maxY = std::min(i.bbox.y + i.bbox.height, orin_rows);
-        i.bbox.x = std::max(i.bbox.x, 0);
-        i.bbox.y = std::max(i.bbox.y, 0);
-        i.bbox.width = maxX - i.bbox.x;
-        i.bbox.height = maxY - i.bbox.y;
+        cv::resize(mask_4x(cv::Rect(ctx.xOffset, ctx.yOffset, 640-2*ctx.xOffset, 640-2*ctx.yOffset)), mask_ori_size, cv::Size(ctx.orinCols, ctx.orinRows));
+        cv::Mat blackImage(cv::Size(ctx.orinCols, ctx.orinRows), CV_32F, cv::Scalar(0, 0, 0));
         mask_ori_size(i.bbox).copyTo(blackImage(i.bbox));
         cv::Mat mask_result;
         blackImage.convertTo(blackImage, CV_8U);
         i.mask = blackImage;
+        if (callbacks && callbacks->onMask) {
+            callbacks->onMask(k, i);
+        }
     }
     return true;
 }
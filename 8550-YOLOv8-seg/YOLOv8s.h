@@ -5,8 +5,10 @@
 #include <string>
 #include <unistd.h>
 #include <memory>
+#include <functional>
 
-#include "SNPETask.h"
+#include "InferenceTask.h"
+#include "PerfGovernor.h"
 #include "YOLOv8s.h"
 
 struct ObjectData {
@@ -18,11 +20,69 @@ struct ObjectData {
     cv::Mat mask;
 };
 
+// Per-call state of one Detect(): the letterbox geometry written by
+// PreProcess() and read back by DecodeBoxes()/DecodeMasks(), and the
+// tensor slot the frame occupies while it is in flight.
+struct FrameContext {
+    size_t slot = 0;
+    float scale = 1.0f;
+    int xOffset = 0;
+    int yOffset = 0;
+    int orinCols = 0;
+    int orinRows = 0;
+
+    // absolute GetTimeStamp_us() after which the result is worthless, 0 for
+    // none. A frame past its deadline is abandoned before pre-processing or
+    // before post-processing; Detect() then returns false with expired set.
+    int64_t deadlineUs = 0;
+    bool expired = false;
+
+    // cpus the stages ran on, -1 if unknown
+    int preprocessCpu = -1;
+    int inferenceCpu = -1;
+    int postprocessCpu = -1;
+
+    // stage timings of the call, in microseconds
+    int64_t slotWaitUs = 0;
+    int64_t preprocessUs = 0;
+    int64_t inferenceUs = 0;
+    // the part of inferenceUs spent executing, without the wait for the
+    // runtime held by other slots or queued on the submit thread
+    int64_t executeUs = 0;
+    int64_t postprocessUs = 0;
+    // from the call until the post-NMS boxes were available
+    int64_t boxesUs = 0;
+};
+
+// Two-phase delivery for DetectStreaming(). All callbacks run on the
+// calling thread; onBoxes and onMask run while the frame holds its tensor
+// slot, so they should hand work off rather than do it.
+struct DetectCallbacks {
+    // final class, score and clipped box of every object, masks not decoded yet
+    std::function<void(const std::vector<ObjectData>& objects)> onBoxes;
+    // objects[index] of the onBoxes list, now with its full-resolution mask
+    std::function<void(size_t index, const ObjectData& object)> onMask;
+    // the frame is finished; false if it failed or expired
+    std::function<void(bool ok)> onDone;
+};
+
 typedef struct _ObjectDetectionConfig {
     std::string model_path;
     runtime_t runtime;
     int labels = 80;
     int grids = 8400;
+    // number of frames that may be in flight at once, i.e. how many threads
+    // can run Detect() concurrently on the one loaded model
+    int slots = 1;
+    // if set, raw output tensors are written here for later REPLAY runs
+    std::string record_path;
+    // simulated inference time of the REPLAY runtime
+    int replay_latency_ms = 0;
+    // initial performance profile, adapted at run time if governor.slo_ms is set
+    perf_profile_t profile = SUSTAINED_HIGH_PERFORMANCE;
+    PerfGovernorConfig governor;
+    // if enabled, execute() is issued from one dedicated thread placed like this
+    ThreadPlacement submit_placement;
     std::vector<std::string> inputLayers;
     std::vector<std::string> outputLayers;
     std::vector<std::string> outputTensors;
@@ -32,7 +92,13 @@ class ObjectDetection {
 public:
     ObjectDetection();
     ~ObjectDetection();
+    // Detect() is thread-safe: callers share the loaded model and block
+    // while all tensor slots are in use.
     bool Detect(const cv::Mat& image, std::vector<ObjectData>& results);
+    bool Detect(const cv::Mat& image, std::vector<ObjectData>& results, FrameContext& ctx);
+    // Same work as Detect(), but the boxes are delivered as soon as NMS is
+    // done and each mask as soon as it is decoded.
+    bool DetectStreaming(const cv::Mat& image, const DetectCallbacks& callbacks, FrameContext& ctx);
     bool Initialize(const ObjectDetectionConfig& config);
     bool DeInitialize();
 
@@ -52,6 +118,25 @@ public:
         return m_isInit;
     }
 
+    perf_profile_t GetPerformanceProfile() const {
+        return m_task ? m_task->getPerformanceProfile() : SUSTAINED_HIGH_PERFORMANCE;
+    }
+
+    size_t GetProfileSwitches() const {
+        return m_governor ? m_governor->Switches() : 0;
+    }
+
+    // per-cpu counts of where each stage of the completed frames ran
+    struct PlacementStats {
+        std::vector<uint64_t> preprocess;
+        std::vector<uint64_t> inference;
+        std::vector<uint64_t> postprocess;
+    };
+
+    PlacementStats GetPlacementStats() const {
+        return { m_preprocessCpus.Counts(), m_inferenceCpus.Counts(), m_postprocessCpus.Counts() };
+    }
+
     static std::vector<ObjectData> nms(std::vector<ObjectData> winList, const float& nms_thresh) {
         if (winList.empty()) {
             return winList;
@@ -87,25 +172,29 @@ private:
     bool m_isRegisteredPreProcess = false;
     bool m_isRegisteredPostProcess = false;
 
-    bool PreProcess(const cv::Mat& frame);
-    bool PostProcess(std::vector<ObjectData> &results, int64_t time);
+    bool PreProcess(const cv::Mat& frame, FrameContext& ctx);
+    bool Run(const cv::Mat& image, std::vector<ObjectData>& results, FrameContext& ctx, const DetectCallbacks* callbacks);
+    bool DecodeBoxes(const FrameContext& ctx, std::vector<ObjectData> &results);
+    bool DecodeMasks(const FrameContext& ctx, std::vector<ObjectData> &results, const DetectCallbacks* callbacks);
     void get_mask(const cv::Mat& mask_info, const cv::Mat& mask_data, cv::Rect bound, cv::Mat& mast_out);
     
-    std::unique_ptr<snpetask::SNPETask> m_task;
+    std::unique_ptr<snpetask::InferenceTask> m_task;
+    std::unique_ptr<PerfGovernor> m_governor;
+    PlacementCounter m_preprocessCpus;
+    PlacementCounter m_inferenceCpus;
+    PlacementCounter m_postprocessCpus;
     std::vector<std::string> m_inputLayers;
     std::vector<std::string> m_outputLayers;
     std::vector<std::string> m_outputTensors;
+    std::string m_recordPath;
 
     int m_labels;
     int m_grids;
-    float* m_output;
+    float* m_output = nullptr;
 
     uint32_t m_minBoxBorder = 16;
     float m_nmsThresh = 0.5f;
     float m_confThresh = 0.5f;
-    float m_scale;
-    int m_xOffset, m_yOffset;
-    int orin_cols, orin_rows;
 };
 
 
@@ -0,0 +1,518 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/opencv.hpp>
+
+#include "YOLOv8s.h"
+#include "CocoEval.h"
+#include "FrameAdmission.h"
+
+// Streams a directory of images or a video file through ObjectDetection and
+// reports throughput, per-stage latency, peak RSS and, given COCO ground
+// truth, box/mask mAP. With --admission the frames are paced like a camera
+// and go through FrameAdmission instead of a lossless queue.
+
+struct Options {
+    std::string input;
+    std::string annotations;
+    std::string model;
+    runtime_t runtime = DSP;
+    std::string record;
+    int replayLatencyMs = 0;
+    int threads = 1;
+    int handoff = 1;
+    int slots = 0;
+    int maxFrames = 0;
+    int warmup = 0;
+    float conf = 0.5f;
+    float nms = 0.5f;
+    perf_profile_t profile = SUSTAINED_HIGH_PERFORMANCE;
+    float sloMs = 0.0f;
+    ThreadPlacement workerPlacement;
+    ThreadPlacement submitPlacement;
+    bool admission = false;
+    FrameAdmissionConfig admissionConfig;
+    float inputFps = 0.0f;
+};
+
+struct Frame {
+    std::string name;
+    cv::Mat image;
+};
+
+static void usage(const char* prog) {
+    printf("Usage: %s --input <image dir | video> [options]\n"
+           "  --annotations <coco.json>  evaluate box/mask mAP against COCO ground truth\n"
+           "  --model <path>             model for SNPE runtimes, record directory for replay\n"
+           "  --runtime <name>           cpu | gpu | gpu_fp16 | dsp | aip | replay (default dsp)\n"
+           "  --record <dir>             write raw outputs for later replay runs\n"
+           "  --replay-latency <ms>      simulated inference time of the replay runtime\n"
+           "  --threads <n>              concurrent Detect() callers (default 1)\n"
+           "  --handoff <n>              frames handed from the reader to a worker at a time\n"
+           "                             (default 1); each frame is still inferred on its own\n"
+           "  --slots <n>                tensor slots, defaults to --threads\n"
+           "  --max-frames <n>           stop after n frames\n"
+           "  --warmup <n>               leave the first n frames out of the statistics\n"
+           "  --conf <score>             confidence threshold (default 0.5)\n"
+           "  --nms <iou>                NMS threshold (default 0.5)\n"
+           "  --profile <name>           burst | high | sustained | balanced | power_saver\n"
+           "  --slo <ms>                 adapt the performance profile to this latency target\n"
+           "  --admission <policy>       latest | drop-oldest | skip-nth, shed load instead of queueing\n"
+           "  --queue <n>                pending frames of drop-oldest / skip-nth (default 4)\n"
+           "  --skip-n <n>               N of skip-nth (default 2)\n"
+           "  --deadline <ms>            abandon frames older than this\n"
+           "  --input-fps <fps>          pace frames like a camera in admission mode\n"
+           "  --worker-cores <cores>     pin pre/post-processing workers: prime,performance,efficiency or a cpu list\n"
+           "  --worker-sched <policy>    other | fifo:<prio> | rr:<prio> for the workers\n"
+           "  --submit-cores <cores>     issue inference from one thread pinned (and isolated) there\n"
+           "  --submit-sched <policy>    scheduling policy of the submit thread\n", prog);
+}
+
+static bool parseRuntime(const std::string& name, runtime_t& runtime) {
+    if (name == "cpu") runtime = CPU;
+    else if (name == "gpu") runtime = GPU;
+    else if (name == "gpu_fp16") runtime = GPU_FLOAT16;
+    else if (name == "dsp") runtime = DSP;
+    else if (name == "aip") runtime = AIP;
+    else if (name == "replay") runtime = REPLAY;
+    else return false;
+    return true;
+}
+
+static bool parseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help" || i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--input") opt.input = value;
+        else if (arg == "--annotations") opt.annotations = value;
+        else if (arg == "--model") opt.model = value;
+        else if (arg == "--record") opt.record = value;
+        else if (arg == "--replay-latency") opt.replayLatencyMs = atoi(value.c_str());
+        else if (arg == "--threads") opt.threads = std::max(1, atoi(value.c_str()));
+        else if (arg == "--handoff") opt.handoff = std::max(1, atoi(value.c_str()));
+        else if (arg == "--slots") opt.slots = std::max(1, atoi(value.c_str()));
+        else if (arg == "--max-frames") opt.maxFrames = atoi(value.c_str());
+        else if (arg == "--warmup") opt.warmup = atoi(value.c_str());
+        else if (arg == "--conf") opt.conf = atof(value.c_str());
+        else if (arg == "--nms") opt.nms = atof(value.c_str());
+        else if (arg == "--slo") opt.sloMs = atof(value.c_str());
+        else if (arg == "--queue") opt.admissionConfig.queue_size = atoi(value.c_str());
+        else if (arg == "--skip-n") opt.admissionConfig.skip_n = atoi(value.c_str());
+        else if (arg == "--deadline") opt.admissionConfig.deadline_ms = atoi(value.c_str());
+        else if (arg == "--input-fps") opt.inputFps = atof(value.c_str());
+        else if (arg == "--worker-cores" || arg == "--submit-cores") {
+            ThreadPlacement& placement = arg == "--worker-cores" ? opt.workerPlacement : opt.submitPlacement;
+            if (!CpuTopology::ParsePlacement(value, placement)) {
+                printf("ERROR: Bad core selection %s\n", value.c_str());
+                return false;
+            }
+            // only explicitly chosen submit cores are kept for the submit
+            // thread; --submit-sched alone would otherwise reserve every cpu
+            placement.isolate = arg == "--submit-cores";
+        } else if (arg == "--worker-sched" || arg == "--submit-sched") {
+            ThreadPlacement& placement = arg == "--worker-sched" ? opt.workerPlacement : opt.submitPlacement;
+            if (!CpuTopology::ParseSchedPolicy(value, placement)) {
+                printf("ERROR: Bad scheduling policy %s\n", value.c_str());
+                return false;
+            }
+        } else if (arg == "--admission") {
+            opt.admission = true;
+            if (value == "latest") opt.admissionConfig.policy = LATEST_WINS;
+            else if (value == "drop-oldest") opt.admissionConfig.policy = DROP_OLDEST;
+            else if (value == "skip-nth") opt.admissionConfig.policy = SKIP_EVERY_NTH;
+            else {
+                printf("ERROR: Unknown admission policy %s\n", value.c_str());
+                return false;
+            }
+        } else if (arg == "--profile") {
+            if (!PerfGovernor::ParseProfile(value, opt.profile)) {
+                printf("ERROR: Unknown profile %s\n", value.c_str());
+                return false;
+            }
+        } else if (arg == "--runtime") {
+            if (!parseRuntime(value, opt.runtime)) {
+                printf("ERROR: Unknown runtime %s\n", value.c_str());
+                return false;
+            }
+        } else {
+            printf("ERROR: Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (opt.slots == 0) opt.slots = opt.threads;
+    opt.admissionConfig.workers = opt.threads;
+    opt.admissionConfig.worker_placement = opt.workerPlacement;
+    // replay without a record directory synthesizes its outputs
+    if (opt.model.empty() && opt.runtime != REPLAY) {
+        opt.model = "../models/modified_yolov8s-seg_ver2_quantize_cached.dlc";
+    }
+    return !opt.input.empty();
+}
+
+// Images of a directory in name order, or the frames of a video.
+class FrameSource {
+public:
+    bool Open(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            printf("ERROR: Can't find %s\n", path.c_str());
+            return false;
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            if (!m_video.open(path)) {
+                printf("ERROR: Can't open video %s\n", path.c_str());
+                return false;
+            }
+            m_isVideo = true;
+            return true;
+        }
+
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr) {
+            printf("ERROR: Can't open directory %s\n", path.c_str());
+            return false;
+        }
+        static const char* exts[] = { ".jpg", ".jpeg", ".png", ".bmp" };
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            std::string lower = name;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            for (const char* ext : exts) {
+                size_t len = strlen(ext);
+                if (lower.size() > len && lower.compare(lower.size() - len, len, ext) == 0) {
+                    m_files.push_back(name);
+                    break;
+                }
+            }
+        }
+        closedir(dir);
+        std::sort(m_files.begin(), m_files.end());
+        m_dir = path;
+        return true;
+    }
+
+    bool Next(Frame& frame) {
+        cv::Mat bgr;
+        if (m_isVideo) {
+            if (!m_video.read(bgr)) {
+                return false;
+            }
+            char name[32];
+            snprintf(name, sizeof(name), "frame_%06zu", m_index++);
+            frame.name = name;
+        } else {
+            while (bgr.empty()) {
+                if (m_index >= m_files.size()) {
+                    return false;
+                }
+                frame.name = m_files[m_index++];
+                bgr = cv::imread(m_dir + "/" + frame.name);
+                if (bgr.empty()) {
+                    printf("WARN : Can't decode %s, skipped\n", frame.name.c_str());
+                }
+            }
+        }
+        cv::cvtColor(bgr, frame.image, cv::COLOR_BGR2RGB);
+        return true;
+    }
+
+private:
+    bool m_isVideo = false;
+    cv::VideoCapture m_video;
+    std::string m_dir;
+    std::vector<std::string> m_files;
+    size_t m_index = 0;
+};
+
+// Bounded hand-off of frame groups from the reader to the workers. This only
+// amortizes the queue locking; there is no batched inference behind it.
+class HandoffQueue {
+public:
+    explicit HandoffQueue(size_t capacity) : m_capacity(capacity) {}
+
+    void Push(std::vector<Frame>&& group) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_groups.size() < m_capacity; });
+        m_groups.push_back(std::move(group));
+        m_notEmpty.notify_one();
+    }
+
+    bool Pop(std::vector<Frame>& group) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return !m_groups.empty() || m_closed; });
+        if (m_groups.empty()) {
+            return false;
+        }
+        group = std::move(m_groups.front());
+        m_groups.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+
+private:
+    size_t m_capacity;
+    bool m_closed = false;
+    std::deque<std::vector<Frame> > m_groups;
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+};
+
+struct StageSamples {
+    std::vector<int64_t> slotWait;
+    std::vector<int64_t> preprocess;
+    std::vector<int64_t> inference;
+    std::vector<int64_t> postprocess;
+    std::vector<int64_t> boxes;
+    std::vector<int64_t> total;
+};
+
+static double percentile(const std::vector<int64_t>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1] / 1000.0;
+}
+
+static void printStage(const char* name, std::vector<int64_t> samples) {
+    std::sort(samples.begin(), samples.end());
+    double mean = 0.0;
+    for (int64_t us : samples) mean += us;
+    mean = samples.empty() ? 0.0 : mean / samples.size() / 1000.0;
+    printf("  %-12s %9.2f %9.2f %9.2f %9.2f %9.2f\n", name, mean,
+           percentile(samples, 50), percentile(samples, 90), percentile(samples, 99),
+           samples.empty() ? 0.0 : samples.back() / 1000.0);
+}
+
+static double peakRssMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    CocoEvaluator evaluator;
+    bool evaluate = !opt.annotations.empty();
+    if (evaluate && !evaluator.Load(opt.annotations)) {
+        return 1;
+    }
+
+    FrameSource source;
+    if (!source.Open(opt.input)) {
+        return 1;
+    }
+    printf("INFO : CPU topology: %s\n", CpuTopology::System().Describe().c_str());
+
+    ObjectDetection detect;
+    ObjectDetectionConfig cfg;
+    cfg.model_path = opt.model;
+    cfg.runtime = opt.runtime;
+    cfg.slots = opt.slots;
+    cfg.record_path = opt.record;
+    cfg.replay_latency_ms = opt.replayLatencyMs;
+    cfg.profile = opt.profile;
+    cfg.governor.slo_ms = opt.sloMs;
+    cfg.submit_placement = opt.submitPlacement;
+    cfg.inputLayers = {"images"};
+    cfg.outputLayers = {"/model.22/Sigmoid", "/model.22/Mul_2", "/model.22/Concat", "/model.22/proto/cv3/act/Mul"};
+    cfg.outputTensors = {"/model.22/Sigmoid_output_0", "/model.22/Mul_2_output_0", "/model.22/Concat_output_0", "output1"};
+    if (!detect.Initialize(cfg)) {
+        printf("ERROR: Can't initialize ObjectDetection\n");
+        return 1;
+    }
+    detect.SetScoreThresh(opt.conf, opt.nms);
+
+    std::atomic<size_t> frames(0);
+    std::atomic<size_t> failures(0);
+    std::atomic<size_t> objects(0);
+    std::mutex statsMutex;
+    StageSamples samples;
+    int64_t measureStart = 0;
+
+    // total_us is the Detect() call, or capture to completion in admission mode
+    auto record = [&] (const std::string& name, const std::vector<ObjectData>& results,
+                       const FrameContext& ctx, int64_t begin_us, int64_t total_us) {
+        size_t index = frames++;
+        objects += results.size();
+        if (evaluate) {
+            evaluator.AddResults(name, results);
+        }
+        if (index < (size_t)opt.warmup) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (measureStart == 0) measureStart = begin_us;
+        samples.slotWait.push_back(ctx.slotWaitUs);
+        samples.preprocess.push_back(ctx.preprocessUs);
+        samples.inference.push_back(ctx.inferenceUs);
+        samples.postprocess.push_back(ctx.postprocessUs);
+        samples.boxes.push_back(ctx.boxesUs);
+        samples.total.push_back(total_us);
+    };
+
+    int64_t start = GetTimeStamp_us();
+    std::unique_ptr<FrameAdmission> admission;
+    if (opt.admission) {
+        std::vector<std::string> names;
+        std::vector<bool> completed;
+        admission.reset(new FrameAdmission(detect, opt.admissionConfig, [&] (const AdmissionResult& result) {
+            std::string name;
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                name = names[result.frameId];
+                completed[result.frameId] = true;
+            }
+            record(name, result.objects, result.ctx, result.captureUs, result.ageUs);
+        }));
+        if (!admission->Start()) {
+            return 1;
+        }
+
+        int64_t period = opt.inputFps > 0 ? (int64_t)(1e6 / opt.inputFps) : 0;
+        int64_t id = 0;
+        Frame frame;
+        while ((opt.maxFrames <= 0 || id < opt.maxFrames) && source.Next(frame)) {
+            if (period > 0) {
+                int64_t wait = start + id * period - GetTimeStamp_us();
+                if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+            }
+            {
+                std::lock_guard<std::mutex> lock(statsMutex);
+                names.push_back(frame.name);
+                completed.push_back(false);
+            }
+            admission->Submit(frame.image, id++, GetTimeStamp_us());
+            frame.image = cv::Mat();
+        }
+        admission->Drain();
+        admission->Stop();
+
+        // a shed frame is a missed frame as far as accuracy goes
+        if (evaluate) {
+            for (size_t i = 0; i < names.size(); i++) {
+                if (!completed[i]) evaluator.AddResults(names[i], {});
+            }
+        }
+    } else {
+        HandoffQueue queue(opt.threads * 2);
+        std::thread reader([&] {
+            size_t count = 0;
+            std::vector<Frame> group;
+            Frame frame;
+            while ((opt.maxFrames <= 0 || count < (size_t)opt.maxFrames) && source.Next(frame)) {
+                group.push_back(std::move(frame));
+                count++;
+                if (group.size() == (size_t)opt.handoff) {
+                    queue.Push(std::move(group));
+                    group.clear();
+                }
+            }
+            if (!group.empty()) {
+                queue.Push(std::move(group));
+            }
+            queue.Close();
+        });
+
+        std::vector<std::thread> workers;
+        for (int t = 0; t < opt.threads; t++) {
+            workers.emplace_back([&] {
+                ApplyPlacement(opt.workerPlacement);
+                std::vector<Frame> group;
+                while (queue.Pop(group)) {
+                    for (auto& frame : group) {
+                        std::vector<ObjectData> results;
+                        FrameContext ctx;
+                        int64_t t0 = GetTimeStamp_us();
+                        if (!detect.Detect(frame.image, results, ctx)) {
+                            frames++;
+                            failures++;
+                            // a failed frame counts as a miss, as in admission mode
+                            if (evaluate) evaluator.AddResults(frame.name, {});
+                            continue;
+                        }
+                        record(frame.name, results, ctx, t0, GetTimeStamp_us() - t0);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        reader.join();
+    }
+    int64_t end = GetTimeStamp_us();
+
+    size_t measured = samples.total.size();
+    double seconds = (end - (measureStart ? measureStart : start)) / 1e6;
+    printf("\nFrames      : %zu (%zu failed, %d warmup)\n", frames.load(), failures.load(), opt.warmup);
+    printf("Objects     : %zu\n", objects.load());
+    printf("Concurrency : %d threads, handoff %d, %d slots\n", opt.threads, opt.handoff, opt.slots);
+    printf("Throughput  : %.2f FPS\n", seconds > 0 ? measured / seconds : 0.0);
+    printf("Peak RSS    : %.1f MB\n", peakRssMB());
+    printf("Profile     : %s (%zu switches)\n", PerfGovernor::ProfileName(detect.GetPerformanceProfile()), detect.GetProfileSwitches());
+    printf("Latency (ms)         mean       p50       p90       p99       max\n");
+    printStage("slot wait", samples.slotWait);
+    printStage("preprocess", samples.preprocess);
+    printStage("inference", samples.inference);
+    printStage("postprocess", samples.postprocess);
+    printStage("boxes ready", samples.boxes);
+    printStage(opt.admission ? "age" : "total", samples.total);
+
+    if (admission) {
+        AdmissionStats stats = admission->GetStats();
+        printf("Admission   : %zu submitted, %zu completed, %zu failed\n", stats.submitted, stats.completed, stats.failed);
+        printf("  dropped   : %zu replaced, %zu oldest, %zu skipped, %zu rejected\n",
+               stats.replaced, stats.droppedOldest, stats.skipped, stats.rejected);
+        printf("  expired   : %zu queued, %zu after inference\n", stats.expiredQueued, stats.expiredInference);
+        printf("  age (ms)  : mean %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+               stats.ageMeanMs, stats.ageP50Ms, stats.ageP90Ms, stats.ageP99Ms, stats.ageMaxMs);
+    }
+
+    ObjectDetection::PlacementStats placement = detect.GetPlacementStats();
+    printf("Placement   :  cpu  class         pre      infer       post\n");
+    for (const CpuInfo& cpu : CpuTopology::System().Cpus()) {
+        size_t id = cpu.id;
+        uint64_t pre = id < placement.preprocess.size() ? placement.preprocess[id] : 0;
+        uint64_t infer = id < placement.inference.size() ? placement.inference[id] : 0;
+        uint64_t post = id < placement.postprocess.size() ? placement.postprocess[id] : 0;
+        if (pre + infer + post == 0) continue;
+        printf("              %4d  %-11s %8llu %10llu %10llu\n", cpu.id, CpuTopology::ClassName(cpu.coreClass),
+               (unsigned long long)pre, (unsigned long long)infer, (unsigned long long)post);
+    }
+
+    if (evaluate) {
+        CocoEvaluator::Summary summary = evaluator.Summarize();
+        printf("Accuracy    : %zu images evaluated\n", summary.images);
+        printf("  box  mAP@[.5:.95] %.4f  mAP@.5 %.4f\n", summary.boxAP, summary.boxAP50);
+        printf("  mask mAP@[.5:.95] %.4f  mAP@.5 %.4f\n", summary.maskAP, summary.maskAP50);
+    }
+
+    detect.DeInitialize();
+    return failures.load() == 0 ? 0 : 2;
+}
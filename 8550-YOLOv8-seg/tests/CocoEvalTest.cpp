@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "CocoEval.h"
+#include "TestCheck.h"
+
+// Four 100x100 images, categories 1 and 3 (labels 0 and 1):
+//   perfect.jpg  one square, x and y 10..49
+//   pair.jpg     the same square and a second one, x and y 60..89
+//   crowd.jpg    the same square and a crowd region, x 60..89, y 20..79,
+//                as compressed RLE (pycocotools rleToString of the runs
+//                6020, then 60 set / 40 clear per column, ending with 1020)
+//   empty.jpg    no annotations
+static const char* kFixture = R"({
+  "images": [
+    { "id": 1, "file_name": "perfect.jpg", "width": 100, "height": 100 },
+    { "id": 2, "file_name": "pair.jpg", "width": 100, "height": 100 },
+    { "id": 3, "file_name": "crowd.jpg", "width": 100, "height": 100 },
+    { "id": 4, "file_name": "val/empty.jpg", "width": 100, "height": 100 }
+  ],
+  "categories": [ { "id": 3, "name": "car" }, { "id": 1, "name": "person" } ],
+  "annotations": [
+    { "id": 1, "image_id": 1, "category_id": 1, "iscrowd": 0, "bbox": [10, 10, 40, 40],
+      "segmentation": [[10, 10, 49, 10, 49, 49, 10, 49]] },
+    { "id": 2, "image_id": 2, "category_id": 1, "iscrowd": 0, "bbox": [10, 10, 40, 40],
+      "segmentation": [[10, 10, 49, 10, 49, 49, 10, 49]] },
+    { "id": 3, "image_id": 2, "category_id": 1, "iscrowd": 0, "bbox": [60, 60, 30, 30],
+      "segmentation": [[60, 60, 89, 60, 89, 89, 60, 89]] },
+    { "id": 4, "image_id": 3, "category_id": 1, "iscrowd": 0, "bbox": [10, 10, 40, 40],
+      "segmentation": [[10, 10, 49, 10, 49, 49, 10, 49]] },
+    { "id": 5, "image_id": 3, "category_id": 1, "iscrowd": 1, "bbox": [60, 20, 30, 60],
+      "segmentation": { "size": [100, 100],
+                        "counts": "Tl5l1X1000000000000000000000000000000000000000000000000000000000dn0" } }
+  ]
+})";
+
+// The fixture in a temporary .json file for the lifetime of the object.
+class FixtureFile {
+public:
+    FixtureFile() {
+        char path[] = "/tmp/cocoevalXXXXXX.json";
+        int fd = mkstemps(path, 5);
+        if (fd < 0) return;
+        close(fd);
+        m_path = path;
+        std::ofstream(m_path) << kFixture;
+    }
+
+    ~FixtureFile() {
+        if (!m_path.empty()) unlink(m_path.c_str());
+    }
+
+    const std::string& Path() const {
+        return m_path;
+    }
+
+private:
+    std::string m_path;
+};
+
+// A detection whose box and full-resolution mask are both exactly rect.
+static ObjectData Detection(int label, float confidence, const cv::Rect& rect) {
+    ObjectData object;
+    object.label = label;
+    object.confidence = confidence;
+    object.bbox = rect;
+    object.mask = cv::Mat::zeros(100, 100, CV_8U);
+    object.mask(rect).setTo(cv::Scalar(1));
+    return object;
+}
+
+static const cv::Rect kSquare(10, 10, 40, 40);
+static const cv::Rect kSecondSquare(60, 60, 30, 30);
+static const cv::Rect kCrowd(60, 20, 30, 60);
+
+static bool Near(double a, double b) {
+    return fabs(a - b) < 1e-6;
+}
+
+static void CheckAP(const CocoEvaluator::Summary& s, double ap) {
+    CHECK(Near(s.boxAP, ap));
+    CHECK(Near(s.boxAP50, ap));
+    CHECK(Near(s.maskAP, ap));
+    CHECK(Near(s.maskAP50, ap));
+    if (!Near(s.boxAP, ap) || !Near(s.maskAP, ap)) {
+        printf("ERROR: expected AP %.6f, got box %.6f/%.6f mask %.6f/%.6f\n",
+               ap, s.boxAP, s.boxAP50, s.maskAP, s.maskAP50);
+    }
+}
+
+static bool LoadFixture(CocoEvaluator& evaluator, const FixtureFile& fixture) {
+    if (!evaluator.Load(fixture.Path())) {
+        g_checkFailures++;
+        return false;
+    }
+    return true;
+}
+
+// Ground truth is read as written: image names, polygon and RLE areas.
+static void TestLoad(const FixtureFile& fixture) {
+    printf("INFO : TestLoad\n");
+    CocoEvaluator evaluator;
+    if (!LoadFixture(evaluator, fixture)) return;
+    CHECK(evaluator.HasImage("perfect.jpg"));
+    CHECK(evaluator.HasImage("/data/coco/val2017/empty.jpg"));
+    CHECK(!evaluator.HasImage("missing.jpg"));
+
+    CHECK_EQ(evaluator.GroundTruthArea("perfect.jpg", 0), 40 * 40);
+    // the compressed RLE decodes to the 30x60 crowd rectangle
+    CHECK_EQ(evaluator.GroundTruthArea("crowd.jpg", 1), 30 * 60);
+    CHECK_EQ(evaluator.GroundTruthArea("crowd.jpg", 2), -1);
+    CHECK_EQ(evaluator.GroundTruthArea("empty.jpg", 0), -1);
+}
+
+// A detection that is exactly the ground truth matches at every threshold.
+static void TestPerfectDetection(const FixtureFile& fixture) {
+    printf("INFO : TestPerfectDetection\n");
+    CocoEvaluator evaluator;
+    if (!LoadFixture(evaluator, fixture)) return;
+    evaluator.AddResults("perfect.jpg", { Detection(0, 0.9f, kSquare) });
+    CocoEvaluator::Summary s = evaluator.Summarize();
+    CHECK_EQ(s.images, 1);
+    CheckAP(s, 1.0);
+}
+
+// Two objects, three detections: the first square twice, then the second.
+// Ranked TP, FP, TP: recall 1/2, 1/2, 1 at precision 1, 1/2, 2/3, which
+// interpolates to 1 for the 51 recall points up to 0.50 and 2/3 for the
+// 50 above, so AP = (51 + 50 * 2/3) / 101 = 253/303. Without the
+// duplicate it would be 1.
+static void TestDuplicateIsFalsePositive(const FixtureFile& fixture) {
+    printf("INFO : TestDuplicateIsFalsePositive\n");
+    CocoEvaluator evaluator;
+    if (!LoadFixture(evaluator, fixture)) return;
+    evaluator.AddResults("pair.jpg", {
+        Detection(0, 0.9f, kSquare),
+        Detection(0, 0.8f, kSquare),
+        Detection(0, 0.7f, kSecondSquare),
+    });
+    CheckAP(evaluator.Summarize(), 253.0 / 303.0);
+}
+
+// The highest-scored detection lies on the crowd region. Ignored, the
+// other one is a TP at precision 1 and AP is 1; counted as FP it would
+// rank first and halve AP.
+static void TestCrowdIsIgnored(const FixtureFile& fixture) {
+    printf("INFO : TestCrowdIsIgnored\n");
+    CocoEvaluator evaluator;
+    if (!LoadFixture(evaluator, fixture)) return;
+    evaluator.AddResults("crowd.jpg", {
+        Detection(0, 0.95f, kCrowd),
+        Detection(0, 0.9f, kSquare),
+    });
+    CheckAP(evaluator.Summarize(), 1.0);
+}
+
+// An image without ground truth only adds false positives: alone it leaves
+// no category to score, next to a perfect image its higher-scored FP ranks
+// first, so precision is 1/2 at every recall and AP is 1/2.
+static void TestImageWithoutGroundTruth(const FixtureFile& fixture) {
+    printf("INFO : TestImageWithoutGroundTruth\n");
+    CocoEvaluator evaluator;
+    if (!LoadFixture(evaluator, fixture)) return;
+    // label 1 (category 3) has no ground truth anywhere and stays unscored
+    evaluator.AddResults("empty.jpg", {
+        Detection(1, 0.95f, kSquare),
+        Detection(0, 0.95f, kSquare),
+    });
+    CocoEvaluator::Summary s = evaluator.Summarize();
+    CHECK_EQ(s.images, 1);
+    CheckAP(s, 0.0);
+
+    evaluator.AddResults("perfect.jpg", { Detection(0, 0.9f, kSquare) });
+    s = evaluator.Summarize();
+    CHECK_EQ(s.images, 2);
+    CheckAP(s, 0.5);
+}
+
+int main(int argc, char** argv) {
+    FixtureFile fixture;
+    CHECK(!fixture.Path().empty());
+    TestLoad(fixture);
+    TestPerfectDetection(fixture);
+    TestDuplicateIsFalsePositive(fixture);
+    TestCrowdIsIgnored(fixture);
+    TestImageWithoutGroundTruth(fixture);
+    return TestResult("CocoEvalTest");
+}
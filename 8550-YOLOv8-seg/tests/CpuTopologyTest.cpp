@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuTopology.h"
+#include "TestCheck.h"
+
+// A throwaway /sys/devices/system/cpu with only the files CpuTopology reads.
+class FakeSysfs {
+public:
+    FakeSysfs() {
+        char dir[] = "/tmp/cputopoXXXXXX";
+        if (mkdtemp(dir)) m_root = dir;
+    }
+
+    ~FakeSysfs() {
+        for (auto it = m_files.rbegin(); it != m_files.rend(); ++it) unlink(it->c_str());
+        for (auto it = m_dirs.rbegin(); it != m_dirs.rend(); ++it) rmdir(it->c_str());
+        rmdir(m_root.c_str());
+    }
+
+    const std::string& Root() const {
+        return m_root;
+    }
+
+    void Online(const std::string& list) {
+        Write("online", list);
+    }
+
+    void Capacity(int cpu, int capacity) {
+        Write("cpu" + std::to_string(cpu) + "/cpu_capacity", std::to_string(capacity));
+    }
+
+    void MaxFreq(int cpu, int khz) {
+        Write("cpu" + std::to_string(cpu) + "/cpufreq/cpuinfo_max_freq", std::to_string(khz));
+    }
+
+private:
+    void Write(const std::string& path, const std::string& text) {
+        std::string full = m_root;
+        size_t start = 0, slash;
+        while ((slash = path.find('/', start)) != std::string::npos) {
+            full = m_root + "/" + path.substr(0, slash);
+            if (mkdir(full.c_str(), 0755) == 0) m_dirs.push_back(full);
+            start = slash + 1;
+        }
+        full = m_root + "/" + path;
+        std::ofstream(full) << text << "\n";
+        m_files.push_back(full);
+    }
+
+    std::string m_root;
+    std::vector<std::string> m_dirs;
+    std::vector<std::string> m_files;
+};
+
+static std::vector<int> Cpus(std::initializer_list<int> cpus) {
+    return std::vector<int>(cpus);
+}
+
+// SM8550: three Cortex-A510, four Cortex-A715/A710 and one Cortex-X3
+static void Write8550Capacities(FakeSysfs& sysfs) {
+    sysfs.Online("0-7");
+    for (int cpu = 0; cpu <= 2; cpu++) sysfs.Capacity(cpu, 325);
+    for (int cpu = 3; cpu <= 6; cpu++) sysfs.Capacity(cpu, 825);
+    sysfs.Capacity(7, 1024);
+}
+
+static void TestThreeCapacityLevels() {
+    printf("INFO : TestThreeCapacityLevels\n");
+    FakeSysfs sysfs;
+    Write8550Capacities(sysfs);
+
+    CpuTopology topology;
+    CHECK(topology.Load(sysfs.Root()));
+    CHECK_EQ(topology.Cpus().size(), 8);
+    CHECK_EQ(topology.MaxCpuId(), 7);
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_EFFICIENCY)) == Cpus({0, 1, 2}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PERFORMANCE)) == Cpus({3, 4, 5, 6}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PRIME)) == Cpus({7}));
+    CHECK(topology.Find(7) && topology.Find(7)->capacity == 1024);
+    CHECK(topology.Describe() == "prime {7}, performance {3,4,5,6}, efficiency {0,1,2}");
+
+    // placements resolve against the loaded classes
+    ThreadPlacement placement;
+    CHECK(CpuTopology::ParsePlacement("prime,performance", placement));
+    CHECK(PlacementCpus(placement, topology) == Cpus({3, 4, 5, 6, 7}));
+    CHECK(CpuTopology::ParsePlacement("0,2-3", placement));
+    CHECK(PlacementCpus(placement, topology) == Cpus({0, 2, 3}));
+    CHECK(!CpuTopology::ParsePlacement("turbo", placement));
+}
+
+// Two performance levels between efficiency and prime, as when the
+// A715 and A710 pairs report different capacities.
+static void TestFourCapacityLevels() {
+    printf("INFO : TestFourCapacityLevels\n");
+    FakeSysfs sysfs;
+    sysfs.Online("0-7");
+    for (int cpu = 0; cpu <= 2; cpu++) sysfs.Capacity(cpu, 325);
+    for (int cpu = 3; cpu <= 4; cpu++) sysfs.Capacity(cpu, 871);
+    for (int cpu = 5; cpu <= 6; cpu++) sysfs.Capacity(cpu, 824);
+    sysfs.Capacity(7, 1024);
+
+    CpuTopology topology;
+    CHECK(topology.Load(sysfs.Root()));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_EFFICIENCY)) == Cpus({0, 1, 2}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PERFORMANCE)) == Cpus({3, 4, 5, 6}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PRIME)) == Cpus({7}));
+}
+
+// A homogeneous host (or one where every cpu reports the same value) is
+// all performance, so "prime" falls back to every cpu.
+static void TestUniformHost() {
+    printf("INFO : TestUniformHost\n");
+    FakeSysfs sysfs;
+    sysfs.Online("0-3");
+    for (int cpu = 0; cpu <= 3; cpu++) sysfs.Capacity(cpu, 1024);
+
+    CpuTopology topology;
+    CHECK(topology.Load(sysfs.Root()));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PERFORMANCE)) == Cpus({0, 1, 2, 3}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_EFFICIENCY) | CORE_CLASS_BIT(CORE_PRIME)).empty());
+    CHECK(topology.Describe() == "performance {0,1,2,3}");
+
+    ThreadPlacement placement;
+    CHECK(CpuTopology::ParsePlacement("prime", placement));
+    CHECK(PlacementCpus(placement, topology) == Cpus({0, 1, 2, 3}));
+
+    // only an online list, no per-cpu capacity or frequency
+    FakeSysfs bare;
+    bare.Online("0-1");
+    CHECK(topology.Load(bare.Root()));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PERFORMANCE)) == Cpus({0, 1}));
+}
+
+// Without cpu_capacity on any one cpu, every cpu is classified by
+// cpufreq/cpuinfo_max_freq instead, so the two scales are never mixed.
+static void TestMaxFreqFallback() {
+    printf("INFO : TestMaxFreqFallback\n");
+    FakeSysfs sysfs;
+    sysfs.Online("0-3,6-7");
+    int freqs[] = { 2016000, 2016000, 2016000, 2803200, 0, 0, 2803200, 3187200 };
+    for (int cpu : { 0, 1, 2, 3, 6, 7 }) sysfs.MaxFreq(cpu, freqs[cpu]);
+    // capacity on some cpus only is not enough to use it
+    sysfs.Capacity(0, 325);
+    sysfs.Capacity(7, 1024);
+
+    CpuTopology topology;
+    CHECK(topology.Load(sysfs.Root()));
+    CHECK_EQ(topology.Cpus().size(), 6);
+    CHECK(topology.Find(4) == nullptr);
+    CHECK(topology.Find(7) && topology.Find(7)->capacity == 3187200);
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_EFFICIENCY)) == Cpus({0, 1, 2}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PERFORMANCE)) == Cpus({3, 6}));
+    CHECK(topology.CpusOf(CORE_CLASS_BIT(CORE_PRIME)) == Cpus({7}));
+}
+
+static std::vector<int> AffinityAfter(const ThreadPlacement& placement, const CpuTopology& topology) {
+    std::vector<int> cpus;
+    std::thread thread([&] {
+        ApplyPlacement(placement, topology);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+            }
+        }
+    });
+    thread.join();
+    return cpus;
+}
+
+// Reserved cpus keep unplaced threads off them until they are released.
+static void TestReservation() {
+    printf("INFO : TestReservation\n");
+    FakeSysfs sysfs;
+    Write8550Capacities(sysfs);
+    CpuTopology topology;
+    CHECK(topology.Load(sysfs.Root()));
+
+    ThreadPlacement submit;
+    CHECK(CpuTopology::ParsePlacement("prime,performance", submit));
+    CHECK(ReserveCpus(submit, topology).empty());     // not isolated
+    submit.isolate = true;
+    std::vector<int> reserved = ReserveCpus(submit, topology);
+    CHECK(reserved == Cpus({3, 4, 5, 6, 7}));
+
+    // the complement is {0,1,2}; what the host actually grants is the part
+    // of it that is online here, but never a reserved cpu
+    for (int cpu : AffinityAfter(ThreadPlacement(), topology)) {
+        CHECK(cpu <= 2);
+    }
+
+    // a second owner of the same cpus keeps them reserved after the first
+    // releases
+    std::vector<int> again = ReserveCpus(submit, topology);
+    ReleaseCpus(reserved);
+    for (int cpu : AffinityAfter(ThreadPlacement(), topology)) {
+        CHECK(cpu <= 2);
+    }
+    ReleaseCpus(again);
+
+    // with nothing reserved an unplaced thread is left alone
+    cpu_set_t before;
+    CPU_ZERO(&before);
+    pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+    CHECK_EQ(AffinityAfter(ThreadPlacement(), topology).size(), CPU_COUNT(&before));
+}
+
+int main(int argc, char** argv) {
+    TestThreeCapacityLevels();
+    TestFourCapacityLevels();
+    TestUniformHost();
+    TestMaxFreqFallback();
+    TestReservation();
+    return TestResult("CpuTopologyTest");
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "ReplayDetector.h"
+#include "ReplayTask.h"
+#include "TestCheck.h"
+
+// What a frame produced, reduced to what must not depend on which thread
+// or tensor slot ran it.
+struct FrameSummary {
+    struct Object {
+        cv::Rect bbox;
+        int label;
+        float confidence;
+        int maskCols;
+        int maskRows;
+        int maskPixels;
+    };
+    std::vector<Object> objects;
+};
+
+static FrameSummary Summarize(const std::vector<ObjectData>& results) {
+    FrameSummary summary;
+    for (const auto& result : results) {
+        summary.objects.push_back(FrameSummary::Object{
+            result.bbox, result.label, result.confidence,
+            result.mask.cols, result.mask.rows,
+            result.mask.empty() ? 0 : cv::countNonZero(result.mask) });
+    }
+    return summary;
+}
+
+static bool SameFrame(const FrameSummary& a, const FrameSummary& b) {
+    if (a.objects.size() != b.objects.size()) return false;
+    for (size_t i = 0; i < a.objects.size(); i++) {
+        const auto& x = a.objects[i];
+        const auto& y = b.objects[i];
+        if (x.bbox != y.bbox || x.label != y.label || x.confidence != y.confidence ||
+            x.maskCols != y.maskCols || x.maskRows != y.maskRows || x.maskPixels != y.maskPixels) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// One image per thread, each with its own size so that the letterbox
+// geometry (scale and offsets) differs between concurrent frames.
+static std::vector<cv::Mat> MakeImages() {
+    const int sizes[][2] = { {640, 640}, {1280, 720}, {480, 640}, {800, 300}, {333, 517} };
+    std::vector<cv::Mat> images;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        images.push_back(cv::Mat(sizes[i][1], sizes[i][0], CV_8UC3,
+                                 cv::Scalar(40 * i, 255 - 40 * i, 90 + 30 * i)));
+    }
+    return images;
+}
+
+// More threads than slots share one ObjectDetection; every frame must
+// match the serial run of the same image, whichever slot it got and
+// whatever ran next to it.
+static void TestConcurrentMatchesSerial() {
+    printf("INFO : TestConcurrentMatchesSerial\n");
+    const int kSlots = 2;
+    const int kIterations = 6;
+    ObjectDetection detector;
+    if (!InitReplayDetector(detector, 5, kSlots)) {
+        g_checkFailures++;
+        return;
+    }
+    std::vector<cv::Mat> images = MakeImages();
+
+    std::vector<FrameSummary> serial;
+    size_t objects = 0;
+    for (const auto& image : images) {
+        std::vector<ObjectData> results;
+        CHECK(detector.Detect(image, results));
+        for (const auto& result : results) {
+            CHECK_EQ(result.mask.cols, image.cols);
+            CHECK_EQ(result.mask.rows, image.rows);
+        }
+        objects += results.size();
+        serial.push_back(Summarize(results));
+    }
+    // the comparison means little if the synthetic frames came out empty
+    CHECK(objects > 0);
+
+    // slots currently held, as seen from inside the frames holding them
+    std::vector<std::atomic<int> > holders(kSlots);
+    for (auto& holder : holders) holder = 0;
+    std::atomic<int> mismatches(0);
+    std::atomic<int> doubleHandouts(0);
+    std::atomic<int> failures(0);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < images.size(); t++) {
+        threads.emplace_back([&, t] {
+            for (int n = 0; n < kIterations; n++) {
+                std::vector<ObjectData> results;
+                FrameContext ctx;
+                bool ok;
+                if (n % 2 == 0) {
+                    ok = detector.Detect(images[t], results, ctx);
+                } else {
+                    // onBoxes runs while the frame holds its slot
+                    DetectCallbacks callbacks;
+                    callbacks.onBoxes = [&] (const std::vector<ObjectData>& boxes) {
+                        results = boxes;
+                        if (ctx.slot >= holders.size() || holders[ctx.slot].fetch_add(1) != 0) {
+                            doubleHandouts++;
+                        }
+                        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                        if (ctx.slot < holders.size()) holders[ctx.slot]--;
+                    };
+                    callbacks.onMask = [&] (size_t index, const ObjectData& object) {
+                        results[index] = object;
+                    };
+                    ok = detector.DetectStreaming(images[t], callbacks, ctx);
+                }
+                if (!ok) {
+                    failures++;
+                } else if (!SameFrame(Summarize(results), serial[t])) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(failures, 0);
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(doubleHandouts, 0);
+    detector.DeInitialize();
+}
+
+// The slot pool on its own: under contention a slot is never held by
+// two threads at once, and every slot is handed out.
+static void TestSlotsAreExclusive() {
+    printf("INFO : TestSlotsAreExclusive\n");
+    const size_t kSlots = 3;
+    snpetask::ReplayTask task(0);
+    task.setInputShape("images", {1, 8, 8, 3});
+    task.setOutputShape("out", {1, 4, 8});
+    std::vector<std::string> layers = {"out"};
+    task.setOutputLayers(layers);
+    CHECK(task.init("", REPLAY, kSlots));
+    CHECK_EQ(task.getSlotCount(), kSlots);
+
+    std::vector<std::atomic<int> > holders(kSlots);
+    std::vector<std::atomic<int> > handouts(kSlots);
+    for (size_t i = 0; i < kSlots; i++) {
+        holders[i] = 0;
+        handouts[i] = 0;
+    }
+    std::atomic<int> doubleHandouts(0);
+    std::atomic<int> invalid(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            for (int n = 0; n < 200; n++) {
+                size_t slot = task.acquireSlot();
+                if (slot >= kSlots) {
+                    invalid++;
+                    continue;
+                }
+                if (holders[slot].fetch_add(1) != 0) doubleHandouts++;
+                handouts[slot]++;
+                std::this_thread::yield();
+                holders[slot]--;
+                task.releaseSlot(slot);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(invalid, 0);
+    CHECK_EQ(doubleHandouts, 0);
+    int total = 0;
+    for (size_t i = 0; i < kSlots; i++) {
+        CHECK(handouts[i] > 0);
+        total += handouts[i];
+    }
+    CHECK_EQ(total, 8 * 200);
+    task.deInit();
+}
+
+int main(int argc, char** argv) {
+    TestConcurrentMatchesSerial();
+    TestSlotsAreExclusive();
+    return TestResult("DetectReentrancyTest");
+}
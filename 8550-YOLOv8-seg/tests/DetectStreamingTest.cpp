@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "ReplayDetector.h"
+#include "TestCheck.h"
+
+// What the callbacks of one DetectStreaming() call saw, in order.
+struct StreamLog {
+    std::vector<std::string> events;
+    std::vector<ObjectData> boxes;
+    std::vector<int> masksPerIndex;
+    bool done = false;
+    bool ok = false;
+};
+
+static DetectCallbacks Record(StreamLog& log, const cv::Mat& image) {
+    DetectCallbacks callbacks;
+    callbacks.onBoxes = [&log] (const std::vector<ObjectData>& objects) {
+        log.events.push_back("boxes");
+        log.boxes = objects;
+        log.masksPerIndex.assign(objects.size(), 0);
+    };
+    callbacks.onMask = [&log, &image] (size_t index, const ObjectData& object) {
+        log.events.push_back("mask");
+        if (index >= log.masksPerIndex.size()) {
+            printf("ERROR: onMask index %zu of %zu objects\n", index, log.masksPerIndex.size());
+            g_checkFailures++;
+            return;
+        }
+        log.masksPerIndex[index]++;
+        // the same object as announced, now with a full-resolution mask
+        CHECK(object.bbox == log.boxes[index].bbox);
+        CHECK_EQ(object.label, log.boxes[index].label);
+        CHECK_EQ(object.mask.cols, image.cols);
+        CHECK_EQ(object.mask.rows, image.rows);
+    };
+    callbacks.onDone = [&log] (bool ok) {
+        log.events.push_back("done");
+        log.done = true;
+        log.ok = ok;
+    };
+    return callbacks;
+}
+
+// Boxes arrive once, final and before any mask; every object then gets
+// exactly one mask, and onDone(true) comes last.
+static void TestDeliveryOrder() {
+    printf("INFO : TestDeliveryOrder\n");
+    ObjectDetection detector;
+    if (!InitReplayDetector(detector, 5)) {
+        g_checkFailures++;
+        return;
+    }
+
+    // wider than the input, so the letterbox pads top and bottom and a
+    // box reaching into the padding has to be clipped
+    cv::Mat image(720, 1280, CV_8UC3, cv::Scalar(30, 160, 220));
+    StreamLog log;
+    FrameContext ctx;
+    CHECK(detector.DetectStreaming(image, Record(log, image), ctx));
+
+    CHECK(!log.boxes.empty());
+    CHECK(!log.events.empty() && log.events.front() == "boxes");
+    CHECK(!log.events.empty() && log.events.back() == "done");
+    CHECK_EQ(log.events.size(), log.boxes.size() + 2);
+    CHECK(log.done && log.ok);
+    for (size_t i = 1; i + 1 < log.events.size(); i++) {
+        CHECK(log.events[i] == "mask");
+    }
+    for (int masks : log.masksPerIndex) {
+        CHECK_EQ(masks, 1);
+    }
+
+    cv::Rect frame(0, 0, image.cols, image.rows);
+    for (const auto& object : log.boxes) {
+        CHECK(object.bbox.width > 0 && object.bbox.height > 0);
+        CHECK((object.bbox & frame) == object.bbox);
+        CHECK(object.mask.empty());
+    }
+
+    // the same objects as the blocking call
+    std::vector<ObjectData> results;
+    CHECK(detector.Detect(image, results));
+    CHECK_EQ(results.size(), log.boxes.size());
+    for (size_t i = 0; i < results.size() && i < log.boxes.size(); i++) {
+        CHECK(results[i].bbox == log.boxes[i].bbox);
+    }
+    detector.DeInitialize();
+}
+
+// With a single slot, a frame started from inside onDone only proceeds if
+// the finished frame has already handed its slot back.
+static void TestSlotReleasedBeforeDone() {
+    printf("INFO : TestSlotReleasedBeforeDone\n");
+    ObjectDetection detector;
+    if (!InitReplayDetector(detector, 5, 1)) {
+        g_checkFailures++;
+        return;
+    }
+
+    cv::Mat image(640, 640, CV_8UC3, cv::Scalar(114, 114, 114));
+    // outlives onDone, so a nested frame stuck on the slot can't deadlock
+    // the test: it is waited for again once DetectStreaming() returns
+    std::future<bool> nested;
+    bool nestedFinished = false;
+    DetectCallbacks callbacks;
+    callbacks.onDone = [&] (bool ok) {
+        CHECK(ok);
+        nested = std::async(std::launch::async, [&detector, &image] {
+            std::vector<ObjectData> results;
+            return detector.Detect(image, results);
+        });
+        nestedFinished = nested.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    };
+    FrameContext ctx;
+    CHECK(detector.DetectStreaming(image, callbacks, ctx));
+    CHECK(nestedFinished);
+    CHECK(nested.valid() && nested.get());
+    detector.DeInitialize();
+}
+
+// A frame already past its deadline never delivers boxes or masks and
+// finishes with onDone(false).
+static void TestExpiredFrame() {
+    printf("INFO : TestExpiredFrame\n");
+    ObjectDetection detector;
+    if (!InitReplayDetector(detector, 5)) {
+        g_checkFailures++;
+        return;
+    }
+
+    cv::Mat image(640, 640, CV_8UC3, cv::Scalar(114, 114, 114));
+    StreamLog log;
+    FrameContext ctx;
+    ctx.deadlineUs = GetTimeStamp_us() - 1000;
+    CHECK(!detector.DetectStreaming(image, Record(log, image), ctx));
+    CHECK(ctx.expired);
+    CHECK(log.events == std::vector<std::string>({ "done" }));
+    CHECK(log.done && !log.ok);
+    detector.DeInitialize();
+}
+
+int main(int argc, char** argv) {
+    TestDeliveryOrder();
+    TestSlotReleasedBeforeDone();
+    TestExpiredFrame();
+    return TestResult("DetectStreamingTest");
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "FrameAdmission.h"
+#include "ReplayDetector.h"
+#include "TestCheck.h"
+
+// Overloads FrameAdmission with a camera-like producer: frames arrive every
+// period_ms while the REPLAY runtime takes replay_latency_ms per inference,
+// so the detector can only keep up with a fraction of them.
+struct OverloadRun {
+    AdmissionStats stats;
+    double maxServiceMs = 0.0;      // slowest pre + inference + post of a completed frame
+};
+
+static OverloadRun Overload(const FrameAdmissionConfig& config, int latency_ms, int frames, int period_ms) {
+    OverloadRun run;
+    ObjectDetection detector;
+    if (!InitReplayDetector(detector, latency_ms)) {
+        g_checkFailures++;
+        return run;
+    }
+
+    std::mutex mutex;
+    FrameAdmission admission(detector, config, [&] (const AdmissionResult& result) {
+        const FrameContext& ctx = result.ctx;
+        double serviceMs = (ctx.preprocessUs + ctx.inferenceUs + ctx.postprocessUs) / 1000.0;
+        std::lock_guard<std::mutex> lock(mutex);
+        run.maxServiceMs = std::max(run.maxServiceMs, serviceMs);
+    });
+    CHECK(admission.Start());
+
+    // one 640x640 frame keeps the letterbox trivial; Submit() only
+    // references it and nothing writes to it
+    cv::Mat image(640, 640, CV_8UC3, cv::Scalar(114, 114, 114));
+    auto next = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        std::this_thread::sleep_until(next);
+        admission.Submit(image, i, GetTimeStamp_us());
+        next += std::chrono::milliseconds(period_ms);
+    }
+    admission.Drain();
+    admission.Stop();
+    run.stats = admission.GetStats();
+
+    const AdmissionStats& s = run.stats;
+    printf("INFO : submitted %zu completed %zu replaced %zu dropped %zu skipped %zu rejected %zu "
+           "expired %zu/%zu failed %zu, age p50 %.1f max %.1f ms, service max %.1f ms\n",
+           s.submitted, s.completed, s.replaced, s.droppedOldest, s.skipped, s.rejected,
+           s.expiredQueued, s.expiredInference, s.failed, s.ageP50Ms, s.ageMaxMs, run.maxServiceMs);
+    detector.DeInitialize();
+    return run;
+}
+
+// Every submitted frame is accounted for exactly once after Drain().
+static void CheckAccounted(const AdmissionStats& s, int frames) {
+    CHECK_EQ(s.submitted, frames);
+    CHECK_EQ(s.completed + s.replaced + s.droppedOldest + s.skipped + s.rejected +
+             s.expiredQueued + s.expiredInference + s.failed, s.submitted);
+    CHECK_EQ(s.failed, 0);
+}
+
+// A completed frame waited for at most the frames ahead of it in the
+// pending queue plus the one in service, then its own service time. An
+// unshed backlog at 4x overload would age by hundreds of milliseconds.
+static void CheckAgeBounded(const OverloadRun& run, int queue_size) {
+    CHECK(run.stats.completed > 0);
+    double bound = (queue_size + 1) * run.maxServiceMs + 20.0;
+    if (run.stats.ageMaxMs > bound) {
+        printf("ERROR: age max %.1f ms exceeds the %.1f ms bound\n", run.stats.ageMaxMs, bound);
+        g_checkFailures++;
+    }
+}
+
+static const int kLatencyMs = 20;
+static const int kPeriodMs = 5;
+static const int kFrames = 200;
+
+static void TestLatestWins() {
+    printf("INFO : TestLatestWins\n");
+    FrameAdmissionConfig config;
+    config.policy = LATEST_WINS;
+    OverloadRun run = Overload(config, kLatencyMs, kFrames, kPeriodMs);
+    const AdmissionStats& s = run.stats;
+    CheckAccounted(s, kFrames);
+    CHECK(s.replaced > 0);
+    CHECK_EQ(s.droppedOldest + s.skipped + s.rejected, 0);
+    CHECK_EQ(s.expiredQueued + s.expiredInference, 0);
+    CheckAgeBounded(run, 1);
+}
+
+static void TestDropOldest() {
+    printf("INFO : TestDropOldest\n");
+    FrameAdmissionConfig config;
+    config.policy = DROP_OLDEST;
+    config.queue_size = 3;
+    OverloadRun run = Overload(config, kLatencyMs, kFrames, kPeriodMs);
+    const AdmissionStats& s = run.stats;
+    CheckAccounted(s, kFrames);
+    CHECK(s.droppedOldest > 0);
+    CHECK_EQ(s.replaced + s.skipped + s.rejected, 0);
+    CHECK_EQ(s.expiredQueued + s.expiredInference, 0);
+    CheckAgeBounded(run, config.queue_size);
+}
+
+static void TestSkipEveryNth() {
+    printf("INFO : TestSkipEveryNth\n");
+    FrameAdmissionConfig config;
+    config.policy = SKIP_EVERY_NTH;
+    config.queue_size = 3;
+    config.skip_n = 2;
+    OverloadRun run = Overload(config, kLatencyMs, kFrames, kPeriodMs);
+    const AdmissionStats& s = run.stats;
+    CheckAccounted(s, kFrames);
+    // skipping every 2nd frame halves the 200 FPS input to 100 FPS, still
+    // more than the detector's 20 ms inference alone allows (50 FPS), so
+    // the queue also fills
+    CHECK(s.skipped > 0);
+    CHECK(s.rejected > 0);
+    CHECK_EQ(s.replaced + s.droppedOldest, 0);
+    CHECK_EQ(s.expiredQueued + s.expiredInference, 0);
+    CheckAgeBounded(run, config.queue_size);
+}
+
+// With inference alone (40 ms) longer than the deadline (30 ms), no frame
+// can complete: the ones that sat in the queue through a whole inference
+// expire before pre-processing, the ones picked up in time expire before
+// post-processing, and the two are counted apart.
+static void TestDeadlines() {
+    printf("INFO : TestDeadlines\n");
+    FrameAdmissionConfig config;
+    config.policy = DROP_OLDEST;
+    config.queue_size = 8;
+    config.deadline_ms = 30;
+    OverloadRun run = Overload(config, 40, kFrames, kPeriodMs);
+    const AdmissionStats& s = run.stats;
+    CheckAccounted(s, kFrames);
+    CHECK(s.expiredQueued > 0);
+    CHECK(s.expiredInference > 0);
+    CHECK_EQ(s.completed, 0);
+
+    // a frame that is already late never reaches the runtime
+    ObjectDetection detector;
+    CHECK(InitReplayDetector(detector, kLatencyMs));
+    FrameAdmission admission(detector, FrameAdmissionConfig(), nullptr);
+    CHECK(admission.Start());
+    cv::Mat image(640, 640, CV_8UC3, cv::Scalar(114, 114, 114));
+    int64_t now = GetTimeStamp_us();
+    CHECK(admission.Submit(image, 0, now - 100000, now - 1000));
+    admission.Drain();
+    admission.Stop();
+    AdmissionStats late = admission.GetStats();
+    CHECK_EQ(late.expiredQueued, 1);
+    CHECK_EQ(late.expiredInference + late.completed, 0);
+}
+
+int main(int argc, char** argv) {
+    TestLatestWins();
+    TestDropOldest();
+    TestSkipEveryNth();
+    TestDeadlines();
+    return TestResult("FrameAdmissionTest");
+}
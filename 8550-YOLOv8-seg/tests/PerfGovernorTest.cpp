@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+#include "PerfGovernor.h"
+#include "ReplayTask.h"
+#include "TestCheck.h"
+
+// Closed-loop model of the backend: each frame takes the replay runtime's
+// simulated latency for the current profile, plus a little deterministic
+// jitter. The governor switches the model through its ApplyFn, exactly as
+// ObjectDetection wires it to InferenceTask::setPerformanceProfile().
+class SimulatedBackend {
+public:
+    SimulatedBackend(int base_ms, perf_profile_t profile, int jitter_ms = 0)
+        : m_baseMs(base_ms), m_jitterMs(jitter_ms), m_profile(profile) {}
+
+    bool Apply(perf_profile_t profile) {
+        m_profile = profile;
+        m_applied.push_back(profile);
+        return true;
+    }
+
+    float NextLatencyMs() {
+        float latency = (float)snpetask::ReplayTask::simulatedLatencyMs(m_baseMs, m_profile);
+        if (m_jitterMs > 0) {
+            m_seed = m_seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            latency += (float)((int)((m_seed >> 33) % (2 * m_jitterMs + 1)) - m_jitterMs);
+        }
+        return latency;
+    }
+
+    // runs n frames through the governor, returns how many switched
+    int Run(PerfGovernor& governor, int n) {
+        int switches = 0;
+        for (int i = 0; i < n; i++) {
+            if (governor.OnFrame(NextLatencyMs())) switches++;
+        }
+        return switches;
+    }
+
+    void SetBaseMs(int base_ms) {
+        m_baseMs = base_ms;
+    }
+
+    int m_baseMs;
+    int m_jitterMs;
+    perf_profile_t m_profile;
+    std::vector<perf_profile_t> m_applied;
+    uint64_t m_seed = 1;
+};
+
+static PerfGovernorConfig MakeConfig(float slo_ms) {
+    PerfGovernorConfig config;
+    config.slo_ms = slo_ms;
+    config.window = 10;
+    config.percentile = 90.0f;
+    config.upper = 1.0f;
+    config.lower = 0.6f;
+    config.hold_windows = 3;
+    return config;
+}
+
+// A window over the SLO steps one profile faster as soon as it completes.
+static void TestStepsFasterOnMiss() {
+    printf("INFO : TestStepsFasterOnMiss\n");
+    SimulatedBackend backend(30, SUSTAINED_HIGH_PERFORMANCE);
+    PerfGovernor governor(MakeConfig(25.0f), backend.m_profile,
+                          [&backend] (perf_profile_t p) { return backend.Apply(p); });
+
+    // 30 ms against 25 ms, but no decision before the window is full
+    CHECK_EQ(backend.Run(governor, 9), 0);
+    CHECK_EQ(governor.Profile(), SUSTAINED_HIGH_PERFORMANCE);
+
+    CHECK_EQ(backend.Run(governor, 1), 1);
+    CHECK_EQ(governor.Profile(), HIGH_PERFORMANCE);
+    CHECK_EQ(backend.m_profile, HIGH_PERFORMANCE);
+
+    // HIGH_PERFORMANCE still misses (26 ms), the next window goes to BURST
+    // (21 ms) and it stays there without holding off
+    CHECK_EQ(backend.Run(governor, 10), 1);
+    CHECK_EQ(governor.Profile(), BURST);
+    CHECK_EQ(backend.Run(governor, 100), 0);
+    CHECK_EQ(governor.Profile(), BURST);
+    CHECK_EQ(governor.Switches(), 2);
+    CHECK(backend.m_applied == std::vector<perf_profile_t>({ HIGH_PERFORMANCE, BURST }));
+}
+
+// Stepping slower needs hold_windows consecutive windows under lower * slo,
+// and a window inside the band restarts the count.
+static void TestStepsSlowerAfterHold() {
+    printf("INFO : TestStepsSlowerAfterHold\n");
+    SimulatedBackend backend(10, SUSTAINED_HIGH_PERFORMANCE);
+    PerfGovernor governor(MakeConfig(40.0f), backend.m_profile,
+                          [&backend] (perf_profile_t p) { return backend.Apply(p); });
+
+    // 10 ms is under 0.6 * 40 ms, but two quiet windows are not enough
+    CHECK_EQ(backend.Run(governor, 20), 0);
+    CHECK_EQ(governor.Profile(), SUSTAINED_HIGH_PERFORMANCE);
+
+    // a window at 30 ms sits between lower and upper and resets the count
+    backend.SetBaseMs(30);
+    CHECK_EQ(backend.Run(governor, 10), 0);
+    backend.SetBaseMs(10);
+    CHECK_EQ(backend.Run(governor, 20), 0);
+    CHECK_EQ(governor.Profile(), SUSTAINED_HIGH_PERFORMANCE);
+
+    // the third quiet window in a row steps one profile slower
+    CHECK_EQ(backend.Run(governor, 10), 1);
+    CHECK_EQ(governor.Profile(), BALANCED);
+    CHECK_EQ(backend.m_profile, BALANCED);
+
+    // BALANCED is 14 ms, still quiet: another hold_windows for the next step
+    CHECK_EQ(backend.Run(governor, 29), 0);
+    CHECK_EQ(backend.Run(governor, 1), 1);
+    CHECK_EQ(governor.Profile(), POWER_SAVER);
+
+    // the slowest profile is a floor
+    CHECK_EQ(backend.Run(governor, 100), 0);
+    CHECK_EQ(governor.Switches(), 2);
+}
+
+// Under steady load the governor settles on the slowest profile that meets
+// the SLO and stays there, instead of flapping between a profile that is
+// too fast and one that misses.
+static void TestNoOscillationUnderSteadyLoad() {
+    printf("INFO : TestNoOscillationUnderSteadyLoad\n");
+    // per profile at 20 ms: burst 14, high 17, sustained 20, balanced 28,
+    // power_saver 44; with a 32 ms SLO, sustained is the answer
+    SimulatedBackend backend(20, BURST, 1);
+    PerfGovernor governor(MakeConfig(32.0f), backend.m_profile,
+                          [&backend] (perf_profile_t p) { return backend.Apply(p); });
+
+    backend.Run(governor, 200);
+    CHECK_EQ(governor.Profile(), SUSTAINED_HIGH_PERFORMANCE);
+    size_t settled = governor.Switches();
+    CHECK(settled <= 2);
+
+    CHECK_EQ(backend.Run(governor, 2000), 0);
+    CHECK_EQ(governor.Switches(), settled);
+    CHECK_EQ(governor.Profile(), SUSTAINED_HIGH_PERFORMANCE);
+
+    // a load step that breaks the SLO is corrected once, then holds again
+    backend.SetBaseMs(34);
+    backend.Run(governor, 200);
+    CHECK(governor.Profile() < SUSTAINED_HIGH_PERFORMANCE);
+    size_t corrected = governor.Switches();
+    CHECK_EQ(backend.Run(governor, 2000), 0);
+    CHECK_EQ(governor.Switches(), corrected);
+}
+
+// The callback runs outside the governor's lock, so it may query the
+// governor (which used to deadlock), and a switch it fails is undone.
+static void TestApplyOutsideLock() {
+    printf("INFO : TestApplyOutsideLock\n");
+    SimulatedBackend backend(30, SUSTAINED_HIGH_PERFORMANCE);
+    bool fail = false;
+    perf_profile_t seen = POWER_SAVER;
+    PerfGovernor* self = nullptr;
+    PerfGovernor governor(MakeConfig(25.0f), backend.m_profile, [&] (perf_profile_t p) {
+        seen = self->Profile();
+        return fail ? false : backend.Apply(p);
+    });
+    self = &governor;
+
+    CHECK_EQ(backend.Run(governor, 10), 1);
+    CHECK_EQ(seen, HIGH_PERFORMANCE);
+    CHECK_EQ(governor.Profile(), HIGH_PERFORMANCE);
+
+    fail = true;
+    CHECK_EQ(backend.Run(governor, 10), 0);
+    CHECK_EQ(governor.Profile(), HIGH_PERFORMANCE);
+    CHECK_EQ(governor.Switches(), 1);
+    CHECK(backend.m_applied == std::vector<perf_profile_t>({ HIGH_PERFORMANCE }));
+}
+
+int main(int argc, char** argv) {
+    TestStepsFasterOnMiss();
+    TestStepsSlowerAfterHold();
+    TestNoOscillationUnderSteadyLoad();
+    TestApplyOutsideLock();
+    return TestResult("PerfGovernorTest");
+}
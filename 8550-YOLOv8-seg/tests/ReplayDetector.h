@@ -0,0 +1,26 @@
+#ifndef __REPLAY_DETECTOR_H__
+#define __REPLAY_DETECTOR_H__
+
+#include <stdio.h>
+
+#include "YOLOv8s.h"
+
+// An ObjectDetection on the REPLAY runtime with synthetic outputs: the
+// same preprocessed frame always yields the same objects, and inference
+// takes latency_ms under the default profile.
+static bool InitReplayDetector(ObjectDetection& detector, int latency_ms, int slots = 1) {
+    ObjectDetectionConfig cfg;
+    cfg.runtime = REPLAY;
+    cfg.replay_latency_ms = latency_ms;
+    cfg.slots = slots;
+    cfg.inputLayers = {"images"};
+    cfg.outputLayers = {"/model.22/Sigmoid", "/model.22/Mul_2", "/model.22/Concat", "/model.22/proto/cv3/act/Mul"};
+    cfg.outputTensors = {"/model.22/Sigmoid_output_0", "/model.22/Mul_2_output_0", "/model.22/Concat_output_0", "output1"};
+    if (!detector.Initialize(cfg)) {
+        printf("ERROR: Can't initialize ObjectDetection with the REPLAY runtime\n");
+        return false;
+    }
+    return true;
+}
+
+#endif // __REPLAY_DETECTOR_H__
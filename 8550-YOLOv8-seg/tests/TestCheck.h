@@ -0,0 +1,36 @@
+#ifndef __TEST_CHECK_H__
+#define __TEST_CHECK_H__
+
+#include <stdio.h>
+
+// Minimal assertion helpers for the test executables: a failed CHECK is
+// reported and counted, and the test exits non-zero at the end so ctest
+// marks it failed while still printing every broken expectation.
+static int g_checkFailures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("ERROR: %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_checkFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) do { \
+        long long _a = (long long)(a), _b = (long long)(b); \
+        if (_a != _b) { \
+            printf("ERROR: %s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                   __FILE__, __LINE__, #a, #b, _a, _b); \
+            g_checkFailures++; \
+        } \
+    } while (0)
+
+static int TestResult(const char* name) {
+    if (g_checkFailures > 0) {
+        printf("ERROR: %s: %d check(s) failed\n", name, g_checkFailures);
+        return 1;
+    }
+    printf("INFO : %s passed\n", name);
+    return 0;
+}
+
+#endif // __TEST_CHECK_H__
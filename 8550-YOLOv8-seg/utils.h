@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <chrono>
 #include <math.h>
 
 #include <opencv2/opencv.hpp>
@@ -15,9 +16,19 @@ typedef enum runtime {
     GPU,
     GPU_FLOAT16,
     DSP,
-    AIP
+    AIP,
+    REPLAY      // recorded or synthetic outputs, no SNPE needed
 }runtime_t;
 
+// ordered from fastest to most frugal
+typedef enum perf_profile {
+    BURST = 0,
+    HIGH_PERFORMANCE,
+    SUSTAINED_HIGH_PERFORMANCE,
+    BALANCED,
+    POWER_SAVER
+}perf_profile_t;
+
 static float calcIoU(const cv::Rect& a, const cv::Rect& b) {
     float xOverlap = std::max(
         0.,
@@ -39,3 +50,10 @@ static int64_t GetTimeStamp_ms()
     std::time_t timestamp =  tp.time_since_epoch().count();
     return timestamp;
 }
+
+// monotonic, for measuring durations and deadlines
+static int64_t GetTimeStamp_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}